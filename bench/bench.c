@@ -0,0 +1,613 @@
+#include "bench.h"
+
+// private functions declaration
+static void *_bench_alloc(void *context, size_t size);
+static void  _bench_append_run(bench_case *bc, size_t ops);
+static bool  _bench_buffer_setup(bench_case *bc);
+static void  _bench_buffer_teardown(bench_case *bc);
+static bool  _bench_cache_check(void);
+static bool  _bench_cache_same(cnc_terminal *ct);
+static void  _bench_case(bench_case *bc);
+static void  _bench_complete_run(bench_case *bc, size_t ops);
+static bool  _bench_complete_setup(bench_case *bc);
+static void  _bench_complete_teardown(bench_case *bc);
+static void  _bench_file_run(bench_case *bc, size_t ops);
+static bool  _bench_file_setup(bench_case *bc);
+static void  _bench_frame_cached_run(bench_case *bc, size_t ops);
+static bool  _bench_frame_setup(bench_case *bc);
+static void  _bench_frame_run(bench_case *bc, size_t ops);
+static void  _bench_frame_teardown(bench_case *bc);
+static void  _bench_free(void *context, void *ptr);
+static void  _bench_insert_run(bench_case *bc, size_t ops);
+static void  _bench_locate_run(bench_case *bc, size_t ops);
+static bool  _bench_locate_setup(bench_case *bc);
+
+static uint64_t _bench_now(void);
+
+static void  _bench_parse_bytes_run(bench_case *bc, size_t ops);
+static void  _bench_parse_value_run(bench_case *bc, size_t ops);
+static void  _bench_push_run(bench_case *bc, size_t ops);
+static void *_bench_realloc(void *context, void *ptr, size_t size);
+static bool  _bench_scroll_setup(bench_case *bc);
+static void  _bench_width_run(bench_case *bc, size_t ops);
+
+// every library allocation of the benchmarks is counted here
+static bench_counter       bench_used;
+static const cnc_allocator bench_allocator = {
+  _bench_alloc, _bench_realloc, _bench_free, &bench_used};
+
+// keeps the compiler from dropping results
+static volatile uint64_t bench_sink;
+
+// one display line: ascii, accented and wide characters
+static const char *bench_line =
+  "the quick brown fox jumps over the lazy dog, ünïcödé, 中文字符 ..\n";
+
+static const char *bench_chars[] = {"a", "Z", "7", " ", "é", "ß",
+                                    "€", "中", "한", "😀", "🚀", "ä"};
+
+// private functions definition
+static void *_bench_alloc(void *context, size_t size)
+{
+  bench_counter *counter = context;
+
+  counter->allocs++;
+  counter->bytes += size;
+
+  return malloc(size);
+}
+
+static void _bench_append_run(bench_case *bc, size_t ops)
+{
+  // a full buffer scrolls, like a display fed forever
+  for (size_t i = 0; i < ops; i++)
+  {
+    cb_append_txt(&bc->buffer, bench_line);
+  }
+}
+
+static bool _bench_buffer_setup(bench_case *bc)
+{
+  return cb_init_with_allocator(&bc->buffer, bc->capacity, &bench_allocator);
+}
+
+static void _bench_buffer_teardown(bench_case *bc)
+{
+  cb_destroy(&bc->buffer);
+  cb_destroy(&bc->pattern);
+}
+
+static bool _bench_cache_check(void)
+{
+  // keys typed between two frames: deleting the last character of the
+  // prompt and typing another one keeps its size, and so does cycling
+  // through completions of the same length
+  static const char *steps[] = {
+    "zq-alpha1", "\x7f" "2", "\x7f\x7f" "beta", "\x1b", "\x1b[5~",
+    "\x1b[6~",  "i",         " zq-al",          "\t",   "\t",
+    "\t",       "\t",
+  };
+  static const char *candidates[] = {"zq-alpha1", "zq-alpha2", "zq-alpha3"};
+
+  // name, setup, run, teardown, capacity, rows, cols, fill
+  bench_case bc   = {"render cache", NULL, NULL, NULL, 0, 24, 80, 10};
+  bool       same = true;
+
+  if (_bench_frame_setup(&bc) == false)
+  {
+    printf("%-34s setup failed\n", bc.name);
+
+    return false;
+  }
+
+  ccp_init(&bc.completion, &bench_allocator);
+
+  for (size_t i = 0; i < sizeof(candidates) / sizeof(*candidates); i++)
+  {
+    ccp_add(&bc.completion, candidates[i], strlen(candidates[i]));
+  }
+
+  ct_set_completion(bc.app.cterm, &bc.completion);
+
+  for (size_t i = 0; same && i < sizeof(steps) / sizeof(*steps); i++)
+  {
+    // an escape sequence is one key
+    if (steps[i][0] == C_ESC)
+    {
+      cbe_headless_key(&bc.headless, (const uint8_t *)steps[i],
+                       strlen(steps[i]));
+    }
+
+    else
+    {
+      cbe_headless_type(&bc.headless, steps[i]);
+    }
+
+    while (bc.headless.event < bc.headless.events_size)
+    {
+      ct_get_user_input(bc.app.cterm);
+    }
+
+    cb_append_txt(&bc.app.cw_display->buffer, bench_line);
+
+    same = _bench_cache_same(bc.app.cterm);
+
+    if (same == false)
+    {
+      printf("%-34s differs after step %zu\n", bc.name, i);
+    }
+  }
+
+  _bench_frame_teardown(&bc);
+  ccp_destroy(&bc.completion);
+
+  return same;
+}
+
+static bool _bench_cache_same(cnc_terminal *ct)
+{
+  // a frame from the render cache, then the same frame with every widget
+  // drawn again: they match byte for byte
+  ct_update(ct);
+
+  size_t size  = ct->frame_size;
+  char  *frame = malloc(size);
+
+  if (frame == NULL)
+  {
+    return false;
+  }
+
+  memcpy(frame, ct->screenbuffer, size);
+
+  for (size_t i = 0; i < ct->widgets_count; i++)
+  {
+    cw_mark_dirty(ct->widgets[i], CW_DIRTY_ALL);
+  }
+
+  ct_update(ct);
+
+  bool same = size == ct->frame_size &&
+              memcmp(frame, ct->screenbuffer, size) == 0;
+
+  free(frame);
+
+  return same;
+}
+
+static void _bench_case(bench_case *bc)
+{
+  if (bc->setup && bc->setup(bc) == false)
+  {
+    printf("%-34s setup failed\n", bc->name);
+
+    return;
+  }
+
+  // double the operations until a run is long enough to time
+  size_t        ops     = 1;
+  uint64_t      elapsed = 0;
+  bench_counter used    = {0};
+
+  for (;;)
+  {
+    bench_used = (bench_counter){0};
+
+    uint64_t start = _bench_now();
+    bc->run(bc, ops);
+    elapsed = _bench_now() - start;
+
+    used = bench_used;
+
+    if (elapsed >= BENCH_MIN_NS || ops >= BENCH_MAX_OPS)
+    {
+      break;
+    }
+
+    ops *= 2;
+  }
+
+  if (bc->teardown)
+  {
+    bc->teardown(bc);
+  }
+
+  printf("%-34s %10zu %12.1f %10.3f", bc->name, ops, (double)elapsed / ops,
+         (double)used.allocs / ops);
+
+  if (bc->rows > 0)
+  {
+    printf(" %12zu\n", bc->frame_bytes);
+  }
+
+  else
+  {
+    printf(" %12s\n", "-");
+  }
+
+  fflush(stdout);
+}
+
+static void _bench_complete_run(bench_case *bc, size_t ops)
+{
+  char      text[CCP_TEXT_MAX];
+  ccp_match match;
+
+  // a Tab on a short word: its matches and a page of them
+  for (size_t i = 0; i < ops; i++)
+  {
+    ccp_find(&bc->completion, "cmd-4", 5, &match);
+
+    for (size_t row = 0; row < CT_COMPLETION_ROWS; row++)
+    {
+      bench_sink += ccp_get(&bc->completion, &match, match.count / 2 + row,
+                            text, sizeof(text));
+    }
+  }
+}
+
+static bool _bench_complete_setup(bench_case *bc)
+{
+  if (ccp_init(&bc->completion, &bench_allocator) == false)
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < BENCH_COMPLETION_SIZE; i++)
+  {
+    char text[64];
+    int  length = snprintf(text, sizeof(text), "cmd-%zu-%s", i * 7919 % 100003,
+                           i % 2 ? "start" : "stop");
+
+    if (ccp_add(&bc->completion, text, (size_t)length) == false)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void _bench_complete_teardown(bench_case *bc)
+{
+  ccp_destroy(&bc->completion);
+}
+
+static void _bench_file_run(bench_case *bc, size_t ops)
+{
+  // a page down per frame, back to the top at the end of the file
+  for (size_t i = 0; i < ops; i++)
+  {
+    if (bc->file->at_end)
+    {
+      bc->file->top_line = 0;
+    }
+
+    bc->file->scroll = (ptrdiff_t)bc->file->frame.height - 2;
+
+    cbe_headless_reset_sink(&bc->headless);
+    ct_update(bc->app.cterm);
+  }
+
+  bc->frame_bytes = bc->headless.sink_size;
+}
+
+static bool _bench_file_setup(bench_case *bc)
+{
+  char  path[] = "/tmp/cnc_bench_XXXXXX";
+  int   fd     = mkstemp(path);
+  FILE *file   = fd >= 0 ? fdopen(fd, "w") : NULL;
+
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  for (size_t size = 0; size < BENCH_FILE_SIZE; size += strlen(bench_line))
+  {
+    fputs(bench_line, file);
+  }
+
+  fclose(file);
+
+  // the empty display shares the screen with the file widget
+  bc->fill = 0;
+
+  bool ready = _bench_frame_setup(bc);
+
+  if (ready)
+  {
+    bc->file = ct_add_widget(bc->app.cterm, WIDGET_FILE);
+    ready    = bc->file != NULL && cw_open_file(bc->file, path) &&
+            ct_setup_widgets(bc->app.cterm);
+  }
+
+  // the map keeps the file until the widget goes
+  unlink(path);
+
+  return ready;
+}
+
+static void _bench_frame_cached_run(bench_case *bc, size_t ops)
+{
+  // nothing changes between frames: every widget copies its last render
+  for (size_t i = 0; i < ops; i++)
+  {
+    cbe_headless_reset_sink(&bc->headless);
+    ct_update(bc->app.cterm);
+  }
+
+  bc->frame_bytes = bc->headless.sink_size;
+}
+
+static bool _bench_frame_setup(bench_case *bc)
+{
+  // rendered into memory: no terminal involved
+  cbe_headless_init(&bc->headless, &bench_allocator, bc->rows, bc->cols);
+
+  cnc_backend backend = cbe_headless_backend(&bc->headless);
+
+  bool ready =
+    ca_init_with_backend(&bc->app, 10, 20, &bench_allocator, &backend) &&
+    ca_setup(&bc->app, "1.0.0", " BENCH", "", " bench");
+
+  if (ready == false)
+  {
+    cbe_headless_destroy(&bc->headless);
+
+    return false;
+  }
+
+  cnc_widget *display = bc->app.cw_display;
+  size_t      target  = DISPLAY_BUFFER_SIZE * bc->fill / 100;
+
+  bc->app.cterm->main_display_widget = display;
+  display->follow                    = true;
+
+  while (display->buffer.size < target)
+  {
+    cb_append_txt(&display->buffer, bench_line);
+  }
+
+  // the first frame wraps the whole buffer
+  ct_update(bc->app.cterm);
+
+  return true;
+}
+
+static void _bench_frame_run(bench_case *bc, size_t ops)
+{
+  cnc_terminal *ct = bc->app.cterm;
+
+  // full frames: the render cache would otherwise copy the last one
+  for (size_t i = 0; i < ops; i++)
+  {
+    for (size_t w = 0; w < ct->widgets_count; w++)
+    {
+      cw_mark_dirty(ct->widgets[w], CW_DIRTY_ALL);
+    }
+
+    cbe_headless_reset_sink(&bc->headless);
+    ct_update(ct);
+  }
+
+  bc->frame_bytes = bc->headless.sink_size;
+}
+
+static void _bench_frame_teardown(bench_case *bc)
+{
+  ca_destroy(&bc->app);
+  cbe_headless_destroy(&bc->headless);
+}
+
+static void _bench_free(void *context, void *ptr)
+{
+  (void)context;
+
+  free(ptr);
+}
+
+static void _bench_insert_run(bench_case *bc, size_t ops)
+{
+  cnc_term_token token = ctt_parse_value('x');
+
+  // insertions in the middle of a buffer growing up to BENCH_INSERT_SIZE
+  for (size_t i = 0; i < ops; i++)
+  {
+    if (bc->buffer.size >= BENCH_INSERT_SIZE)
+    {
+      cb_clear(&bc->buffer);
+    }
+
+    cb_insert(&bc->buffer, token, bc->buffer.size / 2);
+  }
+}
+
+static void _bench_locate_run(bench_case *bc, size_t ops)
+{
+  size_t location = 0;
+
+  for (size_t i = 0; i < ops; i++)
+  {
+    cb_locate_buffer(&bc->buffer, &bc->pattern, &location);
+    bench_sink += location;
+  }
+}
+
+static bool _bench_locate_setup(bench_case *bc)
+{
+  if (_bench_buffer_setup(bc) == false ||
+      cb_init_with_allocator(&bc->pattern, PROMPT_BUFFER_SIZE,
+                             &bench_allocator) == false)
+  {
+    return false;
+  }
+
+  // the pattern only shows up at the end of a full buffer
+  while (bc->buffer.size + 2 * strlen(bench_line) < bc->capacity)
+  {
+    cb_append_txt(&bc->buffer, bench_line);
+  }
+
+  cb_append_txt(&bc->buffer, "a needle in the haystack");
+
+  return cb_set_txt(&bc->pattern, "needle in the haystack");
+}
+
+static uint64_t _bench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void _bench_parse_bytes_run(bench_case *bc, size_t ops)
+{
+  (void)bc;
+
+  size_t         count = sizeof(bench_chars) / sizeof(*bench_chars);
+  cnc_term_token token;
+
+  for (size_t i = 0; i < ops; i++)
+  {
+    ctt_parse_bytes((uint8_t *)bench_chars[i % count], &token);
+    bench_sink += token.token.value + token.token.width;
+  }
+}
+
+static void _bench_parse_value_run(bench_case *bc, size_t ops)
+{
+  (void)bc;
+
+  // printable ascii, control characters and key sequences
+  for (size_t i = 0; i < ops; i++)
+  {
+    cnc_term_token token = ctt_parse_value((uint32_t)(i & 0x7F) + 1);
+    bench_sink += token.token.length;
+  }
+}
+
+static void _bench_push_run(bench_case *bc, size_t ops)
+{
+  cnc_term_token token = ctt_parse_value('x');
+
+  for (size_t i = 0; i < ops; i++)
+  {
+    if (bc->buffer.size >= bc->capacity)
+    {
+      cb_clear(&bc->buffer);
+    }
+
+    cb_push(&bc->buffer, token);
+  }
+}
+
+static void *_bench_realloc(void *context, void *ptr, size_t size)
+{
+  bench_counter *counter = context;
+
+  counter->allocs++;
+  counter->bytes += size;
+
+  return realloc(ptr, size);
+}
+
+static bool _bench_scroll_setup(bench_case *bc)
+{
+  cnc_term_token token = ctt_parse_value('x');
+
+  if (_bench_buffer_setup(bc) == false)
+  {
+    return false;
+  }
+
+  // from now on every push hits a full buffer: _cb_scroll
+  while (bc->buffer.size < bc->capacity)
+  {
+    cb_push(&bc->buffer, token);
+  }
+
+  return true;
+}
+
+static void _bench_width_run(bench_case *bc, size_t ops)
+{
+  (void)bc;
+
+  // code points spread over the first two planes
+  for (size_t i = 0; i < ops; i++)
+  {
+    bench_sink += ctt_c_width((uint32_t)(i * 40503) & 0x1FFFF);
+  }
+}
+
+// main functions
+int main(void)
+{
+  // name, setup, run, teardown, capacity, rows, cols, fill
+  bench_case cases[] = {
+    {"cb_push",
+     _bench_buffer_setup, _bench_push_run,
+     _bench_buffer_teardown, BENCH_BUFFER_SIZE},
+    {"cb_push (full, _cb_scroll)",
+     _bench_scroll_setup, _bench_push_run,
+     _bench_buffer_teardown, BENCH_SCROLL_SIZE},
+    {"cb_insert (middle)",
+     _bench_buffer_setup, _bench_insert_run,
+     _bench_buffer_teardown, BENCH_BUFFER_SIZE},
+    {"cb_append_txt (line)",
+     _bench_buffer_setup, _bench_append_run,
+     _bench_buffer_teardown, DISPLAY_BUFFER_SIZE},
+    {"cb_locate_buffer (full buffer)",
+     _bench_locate_setup, _bench_locate_run,
+     _bench_buffer_teardown, DISPLAY_BUFFER_SIZE},
+    {"ctt_parse_bytes",   NULL, _bench_parse_bytes_run, NULL},
+    {"ctt_c_width",       NULL, _bench_width_run,       NULL},
+    {"ctt_parse_value",   NULL, _bench_parse_value_run, NULL},
+    {"ccp_find + 8 ccp_get (100k)",
+     _bench_complete_setup, _bench_complete_run,
+     _bench_complete_teardown},
+    {"ct_update 24x80, empty",
+     _bench_frame_setup, _bench_frame_run,
+     _bench_frame_teardown, 0, 24, 80, 0},
+    {"ct_update 24x80, half",
+     _bench_frame_setup, _bench_frame_run,
+     _bench_frame_teardown, 0, 24, 80, 50},
+    {"ct_update 24x80, full",
+     _bench_frame_setup, _bench_frame_run,
+     _bench_frame_teardown, 0, 24, 80, 100},
+    {"ct_update 24x80, full, cached",
+     _bench_frame_setup, _bench_frame_cached_run,
+     _bench_frame_teardown, 0, 24, 80, 100},
+    {"ct_update 50x160, half",
+     _bench_frame_setup, _bench_frame_run,
+     _bench_frame_teardown, 0, 50, 160, 50},
+    {"ct_update 50x160, full",
+     _bench_frame_setup, _bench_frame_run,
+     _bench_frame_teardown, 0, 50, 160, 100},
+    {"ct_update 100x300, full",
+     _bench_frame_setup, _bench_frame_run,
+     _bench_frame_teardown, 0, 100, 300, 100},
+    {"ct_update 50x160, file (PgDn)",
+     _bench_file_setup, _bench_file_run,
+     _bench_frame_teardown, 0, 50, 160},
+  };
+
+  // cached renders are only worth timing when they are right
+  if (_bench_cache_check() == false)
+  {
+    return 1;
+  }
+
+  printf("%-34s %10s %12s %10s %12s\n", "benchmark", "ops", "ns/op",
+         "allocs/op", "bytes/frame");
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); i++)
+  {
+    _bench_case(&cases[i]);
+  }
+
+  return 0;
+}
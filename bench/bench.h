@@ -0,0 +1,58 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/lib/cnc_library.h"
+
+// a benchmark doubles its operations until one run takes this long
+#define BENCH_MIN_NS 100000000ull
+#define BENCH_MAX_OPS (1ull << 30)
+
+// buffer sizes of the cnc_buffer benchmarks
+#define BENCH_BUFFER_SIZE 65536
+#define BENCH_SCROLL_SIZE 4096
+#define BENCH_INSERT_SIZE 8192
+
+// candidates of the completion benchmark
+#define BENCH_COMPLETION_SIZE 100000
+
+// bytes of the file scrolled by the file widget benchmark
+#define BENCH_FILE_SIZE (64 * 1024 * 1024)
+
+typedef struct
+{
+  size_t allocs; // alloc and realloc calls
+  size_t bytes;  // bytes requested by them
+
+} bench_counter;
+
+typedef struct bench_case
+{
+  const char *name;
+
+  bool (*setup)(struct bench_case *bc);
+  void (*run)(struct bench_case *bc, size_t ops);
+  void (*teardown)(struct bench_case *bc);
+
+  // cnc_buffer cases: buffer max capacity
+  size_t capacity;
+
+  // ct_update cases: terminal size and display fill (percent)
+  size_t rows;
+  size_t cols;
+  size_t fill;
+
+  cnc_buffer     buffer;
+  cnc_buffer     pattern;
+  cnc_app        app;
+  cbe_headless   headless;
+  cnc_completion completion;
+  cnc_widget    *file; // file widget cases
+
+  size_t frame_bytes; // bytes written by the last frame, ct_update cases
+
+} bench_case;
+
+#endif
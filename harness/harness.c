@@ -0,0 +1,369 @@
+#include "harness.h"
+
+// private functions declaration
+static bool _harness_add(harness_result *hr, uint64_t latency);
+static int  _harness_compare(const void *a, const void *b);
+static bool _harness_input(harness_app *ha, harness_result *hr,
+                           const char *bytes, size_t size);
+
+static uint64_t _harness_now(void);
+static uint64_t _harness_percentile(harness_result *hr, size_t percent);
+
+static void _harness_quit(harness_app *ha);
+static void _harness_report(harness_result *hr);
+static bool _harness_scenario_paste(harness_app *ha, harness_result *hr);
+static bool _harness_scenario_scroll(harness_app *ha, harness_result *hr);
+static bool _harness_scenario_type(harness_app *ha, harness_result *hr);
+static bool _harness_start(harness_app *ha, const char *path, size_t rows,
+                           size_t cols);
+
+// private functions definition
+static bool _harness_add(harness_result *hr, uint64_t latency)
+{
+  if (hr->inputs >= hr->capacity)
+  {
+    size_t    new_capacity = hr->capacity == 0 ? 64 : hr->capacity * 2;
+    uint64_t *new_latencies =
+      realloc(hr->latencies, new_capacity * sizeof(*new_latencies));
+
+    if (new_latencies == NULL)
+    {
+      return false;
+    }
+
+    hr->latencies = new_latencies;
+    hr->capacity  = new_capacity;
+  }
+
+  hr->latencies[hr->inputs++] = latency;
+
+  return true;
+}
+
+static int _harness_compare(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static bool _harness_input(harness_app *ha, harness_result *hr,
+                           const char *bytes, size_t size)
+{
+  /*
+   * write one input (a key or a whole paste) and read the output until it
+   * settles: nothing for HARNESS_SETTLE_MS once the input is written.
+   * the latency is the time from the first byte sent to the last byte
+   * received.
+   */
+
+  uint64_t start   = _harness_now();
+  uint64_t last    = start;
+  size_t   written = 0;
+
+  ha->bytes = 0;
+  ha->hash  = 1469598103934665603ull;
+
+  for (;;)
+  {
+    struct pollfd pfd = {.fd = ha->master, .events = POLLIN};
+
+    if (written < size)
+    {
+      pfd.events |= POLLOUT;
+    }
+
+    int timeout = written < size      ? HARNESS_TIMEOUT_MS
+                  : ha->bytes == 0    ? HARNESS_TIMEOUT_MS
+                                      : HARNESS_SETTLE_MS;
+    int ready   = poll(&pfd, 1, timeout);
+
+    if (ready == -1 && errno == EINTR)
+    {
+      continue;
+    }
+
+    if (ready <= 0)
+    {
+      break;
+    }
+
+    if (pfd.revents & POLLIN)
+    {
+      char    output[1 << 16];
+      ssize_t count = read(ha->master, output, sizeof(output));
+
+      if (count <= 0)
+      {
+        return false;
+      }
+
+      for (ssize_t i = 0; i < count; i++)
+      {
+        ha->hash = (ha->hash ^ (uint8_t)output[i]) * 1099511628211ull;
+      }
+
+      ha->bytes += (size_t)count;
+      last = _harness_now();
+    }
+
+    else if (pfd.revents & (POLLERR | POLLHUP))
+    {
+      return false;
+    }
+
+    if ((pfd.revents & POLLOUT) && written < size)
+    {
+      ssize_t count = write(ha->master, bytes + written, size - written);
+
+      if (count > 0)
+      {
+        written += (size_t)count;
+      }
+    }
+  }
+
+  if (hr != NULL)
+  {
+    hr->bytes += ha->bytes;
+
+    return _harness_add(hr, last - start);
+  }
+
+  return true;
+}
+
+static uint64_t _harness_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t _harness_percentile(harness_result *hr, size_t percent)
+{
+  // latencies are sorted by _harness_report
+  if (hr->inputs == 0)
+  {
+    return 0;
+  }
+
+  size_t index = (hr->inputs - 1) * percent / 100;
+
+  return hr->latencies[index];
+}
+
+static void _harness_quit(harness_app *ha)
+{
+  // back to insert mode, then the sample's quit command
+  _harness_input(ha, NULL, "i", 1);
+  _harness_input(ha, NULL, "q", 1);
+  _harness_input(ha, NULL, "\r", 1);
+
+  for (size_t i = 0; i < 100; i++)
+  {
+    if (waitpid(ha->pid, NULL, WNOHANG) == ha->pid)
+    {
+      close(ha->master);
+
+      return;
+    }
+
+    usleep(10000);
+  }
+
+  kill(ha->pid, SIGKILL);
+  waitpid(ha->pid, NULL, 0);
+  close(ha->master);
+}
+
+static void _harness_report(harness_result *hr)
+{
+  qsort(hr->latencies, hr->inputs, sizeof(*hr->latencies), _harness_compare);
+
+  printf("%-28s %8zu %10zu %10.1f %8.2f %8.2f %8.2f\n", hr->name, hr->inputs,
+         hr->bytes, hr->total_ns / 1e6, _harness_percentile(hr, 50) / 1e6,
+         _harness_percentile(hr, 95) / 1e6, _harness_percentile(hr, 100) / 1e6);
+
+  fflush(stdout);
+}
+
+static bool _harness_scenario_paste(harness_app *ha, harness_result *hr)
+{
+  // one burst with every line, enter included
+  size_t size  = 0;
+  char  *paste = malloc(HARNESS_PASTE_LINES * 16);
+
+  if (paste == NULL)
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < HARNESS_PASTE_LINES; i++)
+  {
+    size += sprintf(paste + size, "line %zu\r", i);
+  }
+
+  uint64_t start  = _harness_now();
+  bool     result = _harness_input(ha, hr, paste, size);
+
+  hr->total_ns = _harness_now() - start;
+  free(paste);
+
+  return result;
+}
+
+static bool _harness_scenario_scroll(harness_app *ha, harness_result *hr)
+{
+  // command mode, then page up until the screen stops changing: the top
+  if (_harness_input(ha, NULL, "\x1b", 1) == false)
+  {
+    return false;
+  }
+
+  uint64_t start = _harness_now();
+  uint64_t hash  = 0;
+
+  for (size_t i = 0; i < HARNESS_SCROLL_LIMIT; i++)
+  {
+    if (_harness_input(ha, hr, "\x1b[5~", 4) == false)
+    {
+      return false;
+    }
+
+    if (ha->hash == hash)
+    {
+      break;
+    }
+
+    hash = ha->hash;
+  }
+
+  hr->total_ns = _harness_now() - start;
+
+  return true;
+}
+
+static bool _harness_scenario_type(harness_app *ha, harness_result *hr)
+{
+  static const char keys[] = "abcdefghijklmnopqrstuvwxyz 0123456789";
+
+  uint64_t start = _harness_now();
+
+  // one key at a time, every HARNESS_TYPE_LINE-th one is enter
+  for (size_t i = 1; i <= HARNESS_TYPE_CHARS; i++)
+  {
+    char key = i % HARNESS_TYPE_LINE == 0 ? '\r'
+                                          : keys[i % (sizeof(keys) - 1)];
+
+    if (_harness_input(ha, hr, &key, 1) == false)
+    {
+      return false;
+    }
+  }
+
+  hr->total_ns = _harness_now() - start;
+
+  return true;
+}
+
+static bool _harness_start(harness_app *ha, const char *path, size_t rows,
+                           size_t cols)
+{
+  int            slave;
+  struct winsize ws = {.ws_row = rows, .ws_col = cols};
+
+  if (openpty(&ha->master, &slave, NULL, NULL, &ws) == -1)
+  {
+    return false;
+  }
+
+  ha->pid = fork();
+
+  if (ha->pid == -1)
+  {
+    return false;
+  }
+
+  // the app gets the pty as its controlling terminal
+  if (ha->pid == 0)
+  {
+    setsid();
+    ioctl(slave, TIOCSCTTY, 0);
+
+    dup2(slave, STDIN_FILENO);
+    dup2(slave, STDOUT_FILENO);
+    dup2(slave, STDERR_FILENO);
+
+    close(slave);
+    close(ha->master);
+
+    execl(path, path, (char *)NULL);
+    _exit(127);
+  }
+
+  close(slave);
+  fcntl(ha->master, F_SETFL, fcntl(ha->master, F_GETFL) | O_NONBLOCK);
+
+  // the first frame
+  return _harness_input(ha, NULL, NULL, 0) && ha->bytes > 0;
+}
+
+// main functions
+int main(int argc, char **argv)
+{
+  const char *path = argc > 1 ? argv[1] : HARNESS_APP;
+  size_t      rows = argc > 2 ? strtoul(argv[2], NULL, 10) : HARNESS_ROWS;
+  size_t      cols = argc > 3 ? strtoul(argv[3], NULL, 10) : HARNESS_COLS;
+
+  harness_app    ha;
+  harness_result results[] = {
+    {.name = "type 1000 chars"},
+    {.name = "append 10k lines (paste)"},
+    {.name = "scroll full scrollback"},
+  };
+
+  bool (*scenarios[])(harness_app *, harness_result *) = {
+    _harness_scenario_type,
+    _harness_scenario_paste,
+    _harness_scenario_scroll,
+  };
+
+  if (_harness_start(&ha, path, rows, cols) == false)
+  {
+    fprintf(stderr, "harness: could not start %s\n", path);
+
+    return 1;
+  }
+
+  printf("%s, %zux%zu\n", path, rows, cols);
+  printf("%-28s %8s %10s %10s %8s %8s %8s\n", "scenario", "inputs", "bytes",
+         "total ms", "p50 ms", "p95 ms", "max ms");
+
+  int status = 0;
+
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(*scenarios); i++)
+  {
+    if (scenarios[i](&ha, &results[i]) == false)
+    {
+      fprintf(stderr, "harness: %s failed\n", results[i].name);
+      status = 1;
+
+      break;
+    }
+
+    _harness_report(&results[i]);
+  }
+
+  _harness_quit(&ha);
+
+  for (size_t i = 0; i < sizeof(results) / sizeof(*results); i++)
+  {
+    free(results[i].latencies);
+  }
+
+  return status;
+}
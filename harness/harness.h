@@ -0,0 +1,60 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// default application and terminal size
+#define HARNESS_APP  "../sample"
+#define HARNESS_ROWS 24
+#define HARNESS_COLS 80
+
+// output is settled after this long without a byte
+#define HARNESS_SETTLE_MS 25
+
+// an input that got no output at all gives up after this long
+#define HARNESS_TIMEOUT_MS 2000
+
+// scenario sizes
+#define HARNESS_TYPE_CHARS   1000
+#define HARNESS_TYPE_LINE    80
+#define HARNESS_PASTE_LINES  10000
+#define HARNESS_SCROLL_LIMIT 10000
+
+typedef struct
+{
+  pid_t pid;
+  int   master;
+
+  // output of the last input: size and a hash to tell screens apart
+  size_t   bytes;
+  uint64_t hash;
+
+} harness_app;
+
+typedef struct
+{
+  const char *name;
+
+  uint64_t *latencies; // ns, one per input
+  size_t    inputs;
+  size_t    capacity;
+  size_t    bytes;    // output bytes of all inputs
+  uint64_t  total_ns; // wall time, settle windows included
+
+} harness_result;
+
+#endif
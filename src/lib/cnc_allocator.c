@@ -0,0 +1,229 @@
+#include "cnc_allocator.h"
+
+// private functions declaration
+static void *_cal_arena_alloc(void *context, size_t size);
+static void  _cal_arena_free(void *context, void *ptr);
+static void *_cal_arena_realloc(void *context, void *ptr, size_t size);
+static void *_cal_malloc(void *context, size_t size);
+static void  _cal_malloc_free(void *context, void *ptr);
+static void *_cal_malloc_realloc(void *context, void *ptr, size_t size);
+
+static const cnc_allocator _cal_default = {
+  _cal_malloc, _cal_malloc_realloc, _cal_malloc_free, NULL};
+
+// private functions definition
+static void *_cal_arena_alloc(void *context, size_t size)
+{
+  cnc_arena       *arena = context;
+  cal_arena_block *block = arena->blocks;
+
+  // each allocation is preceded by its size, so realloc can copy it
+  size_t header = sizeof(size_t);
+
+  if (block != NULL)
+  {
+    uintptr_t base = (uintptr_t)block->data;
+    uintptr_t ptr  = (base + block->used + header + CAL_ARENA_ALIGN - 1) &
+                    ~(uintptr_t)(CAL_ARENA_ALIGN - 1);
+
+    if (ptr - base + size <= block->capacity)
+    {
+      ((size_t *)ptr)[-1] = size;
+      block->used         = ptr - base + size;
+      arena->last         = (void *)ptr;
+
+      return (void *)ptr;
+    }
+  }
+
+  // current block is full: chain a new one, big enough for this request
+  size_t capacity = size + header + CAL_ARENA_ALIGN;
+
+  if (capacity < arena->block_size)
+  {
+    capacity = arena->block_size;
+  }
+
+  block = cal_alloc(&arena->parent, sizeof(*block) + capacity);
+
+  if (block == NULL)
+  {
+    return NULL;
+  }
+
+  block->next     = arena->blocks;
+  block->capacity = capacity;
+  block->used     = 0;
+  arena->blocks   = block;
+
+  return _cal_arena_alloc(context, size);
+}
+
+static void _cal_arena_free(void *context, void *ptr)
+{
+  cnc_arena *arena = context;
+
+  // only the last allocation can be given back
+  if (ptr == NULL || ptr != arena->last)
+  {
+    return;
+  }
+
+  arena->blocks->used =
+    (uintptr_t)ptr - sizeof(size_t) - (uintptr_t)arena->blocks->data;
+  arena->last = NULL;
+}
+
+static void *_cal_arena_realloc(void *context, void *ptr, size_t size)
+{
+  cnc_arena *arena = context;
+
+  if (ptr == NULL)
+  {
+    return _cal_arena_alloc(context, size);
+  }
+
+  size_t old_size = ((size_t *)ptr)[-1];
+
+  // last allocation of the current block: grow or shrink in place
+  if (ptr == arena->last)
+  {
+    cal_arena_block *block  = arena->blocks;
+    size_t           offset = (uintptr_t)ptr - (uintptr_t)block->data;
+
+    if (offset + size <= block->capacity)
+    {
+      ((size_t *)ptr)[-1] = size;
+      block->used         = offset + size;
+
+      return ptr;
+    }
+  }
+
+  void *new_ptr = _cal_arena_alloc(context, size);
+
+  if (new_ptr == NULL)
+  {
+    return NULL;
+  }
+
+  memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+
+  return new_ptr;
+}
+
+static void *_cal_malloc(void *context, size_t size)
+{
+  (void)context;
+
+  return malloc(size);
+}
+
+static void _cal_malloc_free(void *context, void *ptr)
+{
+  (void)context;
+
+  free(ptr);
+}
+
+static void *_cal_malloc_realloc(void *context, void *ptr, size_t size)
+{
+  (void)context;
+
+  return realloc(ptr, size);
+}
+
+// main functions
+void *cal_alloc(const cnc_allocator *cal, size_t size)
+{
+  if (cal == NULL)
+  {
+    cal = &_cal_default;
+  }
+
+  return cal->alloc(cal->context, size);
+}
+
+cnc_allocator cal_arena_allocator(cnc_arena *arena)
+{
+  cnc_allocator cal = {_cal_arena_alloc, _cal_arena_realloc, _cal_arena_free,
+                       arena};
+
+  return cal;
+}
+
+void cal_arena_destroy(cnc_arena *arena)
+{
+  if (arena == NULL)
+  {
+    return;
+  }
+
+  // blocks may hold the arena itself: read everything before freeing
+  cal_arena_block *block  = arena->blocks;
+  cnc_allocator    parent = arena->parent;
+
+  while (block != NULL)
+  {
+    cal_arena_block *next = block->next;
+
+    cal_free(&parent, block);
+    block = next;
+  }
+}
+
+bool cal_arena_init(cnc_arena *arena, const cnc_allocator *parent,
+                    size_t block_size)
+{
+  if (arena == NULL || block_size == 0)
+  {
+    return false;
+  }
+
+  arena->parent     = parent == NULL ? _cal_default : *parent;
+  arena->blocks     = NULL;
+  arena->block_size = block_size;
+  arena->last       = NULL;
+
+  return true;
+}
+
+void cal_arena_usage(const cnc_arena *arena, cal_usage *usage)
+{
+  if (arena == NULL || usage == NULL)
+  {
+    return;
+  }
+
+  for (cal_arena_block *block = arena->blocks; block != NULL;
+       block = block->next)
+  {
+    usage->used += block->used;
+    usage->reserved += sizeof(*block) + block->capacity;
+  }
+}
+
+const cnc_allocator *cal_default(void)
+{
+  return &_cal_default;
+}
+
+void cal_free(const cnc_allocator *cal, void *ptr)
+{
+  if (cal == NULL)
+  {
+    cal = &_cal_default;
+  }
+
+  cal->free(cal->context, ptr);
+}
+
+void *cal_realloc(const cnc_allocator *cal, void *ptr, size_t size)
+{
+  if (cal == NULL)
+  {
+    cal = &_cal_default;
+  }
+
+  return cal->realloc(cal->context, ptr, size);
+}
@@ -0,0 +1,75 @@
+#ifndef CNC_ALLOCATOR_H
+#define CNC_ALLOCATOR_H
+
+// using cal as shorthand for cnc_allocator
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// arena allocations are aligned to this many bytes
+#define CAL_ARENA_ALIGN 16
+
+// memory hooks, every library allocation goes through one of these.
+// a NULL allocator pointer means plain malloc/realloc/free.
+typedef struct
+{
+  void *(*alloc)(void *context, size_t size);
+  void *(*realloc)(void *context, void *ptr, size_t size);
+  void (*free)(void *context, void *ptr);
+
+  void *context;
+
+} cnc_allocator;
+
+typedef struct cal_arena_block
+{
+  struct cal_arena_block *next;
+
+  size_t capacity;
+  size_t used;
+
+  uint8_t data[];
+
+} cal_arena_block;
+
+// bump allocator for memory that lives as long as its owner:
+// free is a no-op (except for the last allocation) and everything is
+// released at once by cal_arena_destroy
+typedef struct
+{
+  cnc_allocator    parent; // where blocks come from
+  cal_arena_block *blocks; // current block first
+  size_t           block_size;
+
+  void *last; // last allocation, can grow or be released in place
+
+} cnc_arena;
+
+// bytes held by a structure: used by its contents, reserved from the
+// allocator. the *_usage functions of each module add to one of these
+typedef struct
+{
+  size_t used;
+  size_t reserved;
+
+} cal_usage;
+
+// main functions
+void *cal_alloc(const cnc_allocator *cal, size_t size);
+
+cnc_allocator cal_arena_allocator(cnc_arena *arena);
+
+void cal_arena_destroy(cnc_arena *arena);
+bool cal_arena_init(cnc_arena *arena, const cnc_allocator *parent,
+                    size_t block_size);
+void cal_arena_usage(const cnc_arena *arena, cal_usage *usage);
+
+const cnc_allocator *cal_default(void);
+
+void  cal_free(const cnc_allocator *cal, void *ptr);
+void *cal_realloc(const cnc_allocator *cal, void *ptr, size_t size);
+
+#endif
@@ -0,0 +1,413 @@
+#include "cnc_backend.h"
+
+// the process terminal: state saved by enter, put back by leave
+typedef struct
+{
+  struct termios orig_term;
+  int            orig_flags;
+
+} cbe_tty_state;
+
+static cbe_tty_state cbe_tty_saved;
+
+// private functions declaration
+static bool    _cbe_headless_enter(void *context);
+static bool    _cbe_headless_get_size(void *context, size_t *rows,
+                                      size_t *cols);
+static void    _cbe_headless_leave(void *context);
+static size_t  _cbe_headless_pending(void *context);
+static size_t  _cbe_headless_read(void *context, uint8_t *bytes, size_t size);
+static bool    _cbe_headless_wait(void *context, int timeout_ms);
+static ssize_t _cbe_headless_write(void *context, const char *bytes,
+                                   size_t size);
+static bool    _cbe_tty_enter(void *context);
+static bool    _cbe_tty_get_size(void *context, size_t *rows, size_t *cols);
+static void    _cbe_tty_leave(void *context);
+static size_t  _cbe_tty_pending(void *context);
+static void    _cbe_tty_puts(const char *str);
+static size_t  _cbe_tty_read(void *context, uint8_t *bytes, size_t size);
+static bool    _cbe_tty_wait(void *context, int timeout_ms);
+static ssize_t _cbe_tty_write(void *context, const char *bytes, size_t size);
+
+// private functions definition
+static bool _cbe_headless_enter(void *context)
+{
+  (void)context;
+
+  return true;
+}
+
+static bool _cbe_headless_get_size(void *context, size_t *rows, size_t *cols)
+{
+  cbe_headless *h = context;
+
+  *rows = h->rows;
+  *cols = h->cols;
+
+  return h->rows > 0 && h->cols > 0;
+}
+
+static void _cbe_headless_leave(void *context)
+{
+  (void)context;
+}
+
+static size_t _cbe_headless_pending(void *context)
+{
+  cbe_headless *h = context;
+
+  // only the current event: a key never merges with the next one
+  if (h->event >= h->events_size)
+  {
+    return 0;
+  }
+
+  return h->events[h->event].length - h->offset;
+}
+
+static size_t _cbe_headless_read(void *context, uint8_t *bytes, size_t size)
+{
+  cbe_headless *h     = context;
+  size_t        count = _cbe_headless_pending(h);
+
+  if (count > size)
+  {
+    count = size;
+  }
+
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  memcpy(bytes, h->events[h->event].bytes + h->offset, count);
+  h->offset += count;
+
+  if (h->offset == h->events[h->event].length)
+  {
+    h->event++;
+    h->offset = 0;
+  }
+
+  // the script was played: start over with an empty one
+  if (h->event == h->events_size)
+  {
+    h->event       = 0;
+    h->events_size = 0;
+  }
+
+  return count;
+}
+
+static bool _cbe_headless_wait(void *context, int timeout_ms)
+{
+  (void)context;
+  (void)timeout_ms;
+
+  // memory never fills up
+  return true;
+}
+
+static ssize_t _cbe_headless_write(void *context, const char *bytes,
+                                   size_t size)
+{
+  cbe_headless *h = context;
+
+  if (h->sink_size + size > h->sink_capacity)
+  {
+    size_t new_capacity =
+      h->sink_capacity == 0 ? CBE_SINK_INIT_CAP : h->sink_capacity;
+
+    while (new_capacity < h->sink_size + size)
+    {
+      new_capacity *= 2;
+    }
+
+    char *new_sink = cal_realloc(h->allocator, h->sink, new_capacity);
+
+    if (new_sink == NULL)
+    {
+      errno = ENOMEM;
+
+      return -1;
+    }
+
+    h->sink          = new_sink;
+    h->sink_capacity = new_capacity;
+  }
+
+  memcpy(h->sink + h->sink_size, bytes, size);
+  h->sink_size += size;
+
+  return (ssize_t)size;
+}
+
+static bool _cbe_tty_enter(void *context)
+{
+  (void)context;
+
+  // clear the screen and go home
+  _cbe_tty_puts("\x1b\x63\x1b[H");
+
+  // read the current terminal attributes and store them
+  if (tcgetattr(STDIN_FILENO, &cbe_tty_saved.orig_term) == -1)
+  {
+    return false;
+  }
+
+  // put the terminal in raw mode
+  struct termios raw_term = cbe_tty_saved.orig_term;
+
+  raw_term.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+  raw_term.c_oflag &= ~(OPOST);
+  raw_term.c_cflag |= (CS8);
+  raw_term.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+  raw_term.c_cc[VMIN]  = 1;
+  raw_term.c_cc[VTIME] = 0;
+
+  if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw_term) == -1)
+  {
+    return false;
+  }
+
+  // frames are written without blocking from here on
+  cbe_tty_saved.orig_flags = fcntl(STDOUT_FILENO, F_GETFL);
+
+  if (cbe_tty_saved.orig_flags != -1)
+  {
+    fcntl(STDOUT_FILENO, F_SETFL, cbe_tty_saved.orig_flags | O_NONBLOCK);
+  }
+
+  return true;
+}
+
+static bool _cbe_tty_get_size(void *context, size_t *rows, size_t *cols)
+{
+  (void)context;
+
+  struct winsize ws;
+
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0 ||
+      ws.ws_row == 0)
+  {
+    return false;
+  }
+
+  *rows = ws.ws_row;
+  *cols = ws.ws_col;
+
+  return true;
+}
+
+static void _cbe_tty_leave(void *context)
+{
+  (void)context;
+
+  if (cbe_tty_saved.orig_flags != -1)
+  {
+    fcntl(STDOUT_FILENO, F_SETFL, cbe_tty_saved.orig_flags);
+  }
+
+  tcsetattr(STDIN_FILENO, TCSAFLUSH, &cbe_tty_saved.orig_term);
+
+  // restore cursor and color, clear screen
+  _cbe_tty_puts("\x1b[5 q\x1b[?25h\x1b[0m\x1b\x63\x1b[H");
+}
+
+static size_t _cbe_tty_pending(void *context)
+{
+  (void)context;
+
+  int bytes_read = 0;
+
+  if (ioctl(STDIN_FILENO, FIONREAD, &bytes_read) == -1 || bytes_read < 0)
+  {
+    return 0;
+  }
+
+  return (size_t)bytes_read;
+}
+
+static void _cbe_tty_puts(const char *str)
+{
+  if (write(STDOUT_FILENO, str, strlen(str)) == -1)
+  {
+  }
+}
+
+static size_t _cbe_tty_read(void *context, uint8_t *bytes, size_t size)
+{
+  (void)context;
+
+  ssize_t count = read(STDIN_FILENO, bytes, size);
+
+  return count < 0 ? 0 : (size_t)count;
+}
+
+static bool _cbe_tty_wait(void *context, int timeout_ms)
+{
+  (void)context;
+
+  struct pollfd pfd = {.fd = STDOUT_FILENO, .events = POLLOUT};
+
+  while (poll(&pfd, 1, timeout_ms) == -1)
+  {
+    if (errno != EINTR)
+    {
+      return false;
+    }
+  }
+
+  return (pfd.revents & (POLLERR | POLLNVAL)) == 0;
+}
+
+static ssize_t _cbe_tty_write(void *context, const char *bytes, size_t size)
+{
+  (void)context;
+
+  return write(STDOUT_FILENO, bytes, size);
+}
+
+// main functions
+cnc_backend cbe_headless_backend(cbe_headless *h)
+{
+  return (cnc_backend){
+    .enter    = _cbe_headless_enter,
+    .leave    = _cbe_headless_leave,
+    .get_size = _cbe_headless_get_size,
+    .pending  = _cbe_headless_pending,
+    .read     = _cbe_headless_read,
+    .write    = _cbe_headless_write,
+    .wait     = _cbe_headless_wait,
+    .context  = h,
+  };
+}
+
+void cbe_headless_destroy(cbe_headless *h)
+{
+  if (h == NULL)
+  {
+    return;
+  }
+
+  cal_free(h->allocator, h->events);
+  cal_free(h->allocator, h->sink);
+
+  h->events = NULL;
+  h->sink   = NULL;
+}
+
+bool cbe_headless_init(cbe_headless *h, const cnc_allocator *allocator,
+                       size_t rows, size_t cols)
+{
+  if (h == NULL)
+  {
+    return false;
+  }
+
+  memset(h, 0, sizeof(*h));
+
+  h->allocator = allocator == NULL ? cal_default() : allocator;
+  h->rows      = rows;
+  h->cols      = cols;
+
+  return true;
+}
+
+bool cbe_headless_key(cbe_headless *h, const uint8_t *bytes, size_t length)
+{
+  if (h == NULL || bytes == NULL || length == 0 ||
+      length > CTT_MAX_TOKEN_SIZE)
+  {
+    return false;
+  }
+
+  if (h->events_size >= h->events_capacity)
+  {
+    size_t new_capacity = h->events_capacity == 0 ? CBE_EVENTS_INIT_CAP
+                                                  : h->events_capacity * 2;
+
+    cbe_event *new_events = cal_realloc(h->allocator, h->events,
+                                        new_capacity * sizeof(*new_events));
+
+    if (new_events == NULL)
+    {
+      return false;
+    }
+
+    h->events          = new_events;
+    h->events_capacity = new_capacity;
+  }
+
+  cbe_event *event = &h->events[h->events_size++];
+
+  memcpy(event->bytes, bytes, length);
+  event->length = (uint8_t)length;
+
+  return true;
+}
+
+void cbe_headless_reset_sink(cbe_headless *h)
+{
+  if (h != NULL)
+  {
+    h->sink_size = 0;
+  }
+}
+
+void cbe_headless_resize(cbe_headless *h, size_t rows, size_t cols)
+{
+  // takes effect with ct_resize
+  if (h != NULL)
+  {
+    h->rows = rows;
+    h->cols = cols;
+  }
+}
+
+bool cbe_headless_type(cbe_headless *h, const char *text)
+{
+  if (h == NULL || text == NULL)
+  {
+    return false;
+  }
+
+  // one event per UTF-8 character
+  const uint8_t *bytes = (const uint8_t *)text;
+
+  while (*bytes)
+  {
+    size_t length = (*bytes & 0xE0) == 0xC0   ? 2
+                    : (*bytes & 0xF0) == 0xE0 ? 3
+                    : (*bytes & 0xF8) == 0xF0 ? 4
+                                              : 1;
+
+    if (strnlen((const char *)bytes, length) < length)
+    {
+      length = strnlen((const char *)bytes, length);
+    }
+
+    if (cbe_headless_key(h, bytes, length) == false)
+    {
+      return false;
+    }
+
+    bytes += length;
+  }
+
+  return true;
+}
+
+cnc_backend cbe_tty(void)
+{
+  return (cnc_backend){
+    .enter    = _cbe_tty_enter,
+    .leave    = _cbe_tty_leave,
+    .get_size = _cbe_tty_get_size,
+    .pending  = _cbe_tty_pending,
+    .read     = _cbe_tty_read,
+    .write    = _cbe_tty_write,
+    .wait     = _cbe_tty_wait,
+    .context  = &cbe_tty_saved,
+  };
+}
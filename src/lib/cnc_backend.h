@@ -0,0 +1,91 @@
+#ifndef CNC_BACKEND_H
+#define CNC_BACKEND_H
+
+// using cbe as shorthand for cnc_backend
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "cnc_allocator.h"
+#include "cnc_term_token.h"
+
+// headless input queue initial capacity (events)
+#define CBE_EVENTS_INIT_CAP 64
+
+// headless output sink initial capacity (bytes)
+#define CBE_SINK_INIT_CAP 4096
+
+// where a terminal reads keys and writes frames. cbe_tty is the process
+// terminal, cbe_headless_backend renders into memory with a set size and
+// scripted input, so the whole ct_update pipeline runs without a TTY.
+typedef struct
+{
+  // raw mode and non-blocking output on enter, the original state on leave
+  bool (*enter)(void *context);
+  void (*leave)(void *context);
+
+  bool (*get_size)(void *context, size_t *rows, size_t *cols);
+
+  // input bytes available now, and reading them: never blocks
+  size_t (*pending)(void *context);
+  size_t (*read)(void *context, uint8_t *bytes, size_t size);
+
+  // output: like write(2), -1 with errno EAGAIN when the terminal is full.
+  // wait returns once writing can go on or after timeout_ms, false on errors
+  ssize_t (*write)(void *context, const char *bytes, size_t size);
+  bool (*wait)(void *context, int timeout_ms);
+
+  void *context;
+
+} cnc_backend;
+
+typedef struct
+{
+  uint8_t bytes[CTT_MAX_TOKEN_SIZE];
+  uint8_t length;
+
+} cbe_event;
+
+typedef struct
+{
+  const cnc_allocator *allocator;
+
+  size_t rows;
+  size_t cols;
+
+  // scripted input: one key (one token) per event
+  cbe_event *events;
+  size_t     events_size;
+  size_t     events_capacity;
+  size_t     event;  // event being read
+  size_t     offset; // bytes of that event already read
+
+  // memory sink: every byte written since the last reset
+  char  *sink;
+  size_t sink_size;
+  size_t sink_capacity;
+
+} cbe_headless;
+
+// main functions
+cnc_backend cbe_headless_backend(cbe_headless *h);
+void        cbe_headless_destroy(cbe_headless *h);
+bool cbe_headless_init(cbe_headless *h, const cnc_allocator *allocator,
+                       size_t rows, size_t cols);
+bool cbe_headless_key(cbe_headless *h, const uint8_t *bytes, size_t length);
+void cbe_headless_reset_sink(cbe_headless *h);
+void cbe_headless_resize(cbe_headless *h, size_t rows, size_t cols);
+bool cbe_headless_type(cbe_headless *h, const char *text);
+cnc_backend cbe_tty(void);
+
+#endif
@@ -1,9 +1,68 @@
 #include "cnc_buffer.h"
 
+// appended in place of bytes that are not valid UTF-8 (cb_append_bytes)
+#define CB_REPLACEMENT 0xFFFD
+
 // private functions declaration
-static void _cb_scroll(cnc_buffer *cb);
+static void   _cb_drop(cnc_buffer *cb, size_t count);
+static bool   _cb_match_c_str(const cnc_buffer *cb, size_t index,
+                              const char *str, size_t *end_index);
+static void   _cb_scroll(cnc_buffer *cb);
+static size_t _cb_search_hash(uint32_t value);
+static void   _cb_styles_drop(cnc_buffer *cb, size_t count);
+static void   _cb_styles_insert(cnc_buffer *cb, size_t index);
+static void   _cb_styles_remove(cnc_buffer *cb, size_t index);
+static bool   _cb_styles_reserve(cnc_buffer *cb, size_t count);
 
 // private functions definition
+static void _cb_drop(cnc_buffer *cb, size_t count)
+{
+  // the oldest tokens leave from the front
+  CTR_BEGIN("evict");
+  memmove(cb->data, cb->data + count,
+          (cb->size - count) * sizeof(cnc_term_token));
+
+  cb->size -= count;
+  cb->dropped += count;
+  cb->changes++;
+
+  _cb_styles_drop(cb, count);
+  CTR_END("evict");
+}
+
+static bool _cb_match_c_str(const cnc_buffer *cb, size_t index,
+                            const char *str, size_t *end_index)
+{
+  // compare token bytes against the UTF-8 input, token by token.
+  // true when the whole string matched on token boundaries.
+  const uint8_t *bytes = (const uint8_t *)str;
+
+  while (*bytes)
+  {
+    if (index >= cb->size)
+    {
+      return false;
+    }
+
+    const cnc_term_token *t = &cb->data[index];
+
+    for (size_t j = 0; j < t->token.length; j++)
+    {
+      if (bytes[j] == C_NUL || bytes[j] != t->seq[j])
+      {
+        return false;
+      }
+    }
+
+    bytes += t->token.length;
+    index++;
+  }
+
+  *end_index = index;
+
+  return true;
+}
+
 static void _cb_scroll(cnc_buffer *cb)
 {
   if (cb == NULL || cb->data == NULL || cb->size == 0)
@@ -18,10 +77,104 @@ static void _cb_scroll(cnc_buffer *cb)
     return;
   }
 
-  memmove(cb->data, cb->data + shift,
-          (cb->size - shift) * sizeof(cnc_term_token));
+  _cb_drop(cb, shift);
+}
 
-  cb->size -= shift;
+static size_t _cb_search_hash(uint32_t value)
+{
+  return (value ^ (value >> 8)) & (CB_SEARCH_SHIFT_SIZE - 1);
+}
+
+static void _cb_styles_drop(cnc_buffer *cb, size_t count)
+{
+  // count tokens left the front of the buffer
+  size_t k = 0;
+
+  while (k < cb->styles_size && cb->styles[k].start <= count)
+  {
+    k++;
+  }
+
+  // the last span starting in the dropped range now covers the front
+  if (k > 1)
+  {
+    memmove(cb->styles, cb->styles + k - 1,
+            (cb->styles_size - k + 1) * sizeof(*cb->styles));
+
+    cb->styles_size -= k - 1;
+  }
+
+  for (size_t i = 0; i < cb->styles_size; i++)
+  {
+    cb->styles[i].start =
+      cb->styles[i].start > count ? cb->styles[i].start - count : 0;
+  }
+}
+
+static void _cb_styles_insert(cnc_buffer *cb, size_t index)
+{
+  // a token is inserted at index (cb->size not updated yet): it takes
+  // the style of the token before it, unless it is appended at the end
+  for (size_t i = 0; i < cb->styles_size; i++)
+  {
+    if (cb->styles[i].start > index ||
+        (cb->styles[i].start == index && index < cb->size))
+    {
+      cb->styles[i].start++;
+    }
+  }
+}
+
+static void _cb_styles_remove(cnc_buffer *cb, size_t index)
+{
+  size_t kept = 0;
+
+  for (size_t i = 0; i < cb->styles_size; i++)
+  {
+    if (cb->styles[i].start > index)
+    {
+      cb->styles[i].start--;
+    }
+
+    // two spans on the same token: the later one wins
+    if (kept > 0 && cb->styles[kept - 1].start == cb->styles[i].start)
+    {
+      kept--;
+    }
+
+    cb->styles[kept++] = cb->styles[i];
+  }
+
+  cb->styles_size = kept;
+}
+
+static bool _cb_styles_reserve(cnc_buffer *cb, size_t count)
+{
+  if (count <= cb->styles_capacity)
+  {
+    return true;
+  }
+
+  size_t new_capacity =
+    cb->styles_capacity == 0 ? CB_STYLES_INIT_CAP : cb->styles_capacity * 2;
+
+  if (new_capacity < count)
+  {
+    new_capacity = count;
+  }
+
+  cb_style_span *new_styles = cal_realloc(cb->allocator, cb->styles,
+                                          new_capacity * sizeof(*new_styles));
+
+  if (new_styles == NULL)
+  {
+    return false;
+  }
+
+  cb->styles          = new_styles;
+  cb->styles_capacity = new_capacity;
+
+  return true;
 }
 
 // main functions
@@ -32,14 +185,72 @@ bool cb_append_buf(cnc_buffer *dst, const cnc_buffer *src)
     return false;
   }
 
+  size_t k = 0;
+
   for (size_t i = 0; i < src->size; i++)
   {
+    // replay src styles as the tokens they start at are appended
+    while (k < src->styles_size && src->styles[k].start <= i)
+    {
+      cb_set_style(dst, src->styles[k].style);
+      k++;
+    }
+
     if (cb_push(dst, src->data[i]) == false)
     {
       return false;
     }
   }
 
+  // pending style set after the last token of src
+  while (k < src->styles_size)
+  {
+    cb_set_style(dst, src->styles[k].style);
+    k++;
+  }
+
+  return true;
+}
+
+bool cb_append_bytes(cnc_buffer *cb, const char *bytes, size_t length)
+{
+  if (cb == NULL || (bytes == NULL && length > 0))
+  {
+    return false;
+  }
+
+  for (size_t offset = 0; offset < length;)
+  {
+    // a character is parsed from a copy: the bytes are not NUL terminated
+    cnc_term_token token = {0};
+    uint8_t        seq[CTT_MAX_TOKEN_SIZE] = {0};
+    size_t         left                    = length - offset;
+
+    memcpy(seq, bytes + offset, left < sizeof(seq) ? left : sizeof(seq));
+
+    bool status = cb->lazy_width ? ctt_parse_bytes_lazy(seq, &token)
+                                 : ctt_parse_bytes(seq, &token);
+
+    // invalid, cut or overlong UTF-8 and C1 controls: one replacement
+    // character for the first byte, the text goes on after it
+    if (status == false || token.token.length > left ||
+        (token.token.type == CTT_UTF8 && token.token.value < 0xA0))
+    {
+      token = ctt_parse_value(CB_REPLACEMENT);
+      offset += 1;
+    }
+
+    else
+    {
+      offset += token.token.length;
+    }
+
+    if (cb_push(cb, token) == false)
+    {
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -58,7 +269,8 @@ bool cb_append_txt(cnc_buffer *cb, const char *text)
     unsigned char *start = (unsigned char *)text;
 
     // Pass the next `utf8_len` bytes to `ctt_parse_bytes()`
-    bool status = ctt_parse_bytes(start, &token);
+    bool status = cb->lazy_width ? ctt_parse_bytes_lazy(start, &token)
+                                 : ctt_parse_bytes(start, &token);
 
     if (status != true)
     {
@@ -85,7 +297,10 @@ void cb_clear(cnc_buffer *cb)
   }
 
   memset(cb->data, 0, cb->size * sizeof(cnc_term_token));
-  cb->size = 0;
+  cb->size        = 0;
+  cb->styles_size = 0;
+  cb->version++;
+  cb->changes++;
 }
 
 size_t cb_data_length(cnc_buffer *cb, size_t start_index, size_t count)
@@ -134,7 +349,7 @@ size_t cb_data_width(cnc_buffer *cb, size_t start_index, size_t count)
     if (cb->data[i + start_index].token.type == CTT_CHAR ||
         cb->data[i + start_index].token.type == CTT_UTF8)
     {
-      width += cb->data[i + start_index].token.width;
+      width += ctt_resolve_width(&cb->data[i + start_index]);
     }
   }
 
@@ -148,11 +363,16 @@ void cb_destroy(cnc_buffer *cb)
     return;
   }
 
-  free(cb->data);
+  cal_free(cb->allocator, cb->data);
   cb->data = NULL;
 
-  cb->size     = 0;
-  cb->capacity = 0;
+  cal_free(cb->allocator, cb->styles);
+  cb->styles = NULL;
+
+  cb->size            = 0;
+  cb->capacity        = 0;
+  cb->styles_size     = 0;
+  cb->styles_capacity = 0;
 }
 
 bool cb_equal(cnc_buffer *cb, cnc_buffer *match)
@@ -180,42 +400,62 @@ bool cb_equal(cnc_buffer *cb, cnc_buffer *match)
 
 bool cb_equal_c_str(cnc_buffer *cb, char *str)
 {
-  if (cb == NULL || str == NULL)
+  if (cb == NULL || cb->data == NULL || str == NULL)
   {
     return false;
   }
 
-  cnc_buffer cb_str;
+  size_t end_index;
 
-  if (cb_init(&cb_str, strlen(str)) == false)
-  {
-    return false;
-  }
+  return _cb_match_c_str(cb, 0, str, &end_index) && end_index == cb->size;
+}
 
-  if (cb_set_txt(&cb_str, str) == false)
+const cnc_term_token *cb_get(const cnc_buffer *cb, size_t index)
+{
+  if (cb == NULL || cb->data == NULL || index >= cb->size)
   {
-    cb_destroy(&cb_str);
-
-    return false;
+    return NULL;
   }
 
-  bool return_value = cb_equal(cb, &cb_str);
-  cb_destroy(&cb_str);
-
-  return return_value;
+  return &cb->data[index];
 }
 
-const cnc_term_token *cb_get(const cnc_buffer *cb, size_t index)
+const cb_style_span *cb_get_style(const cnc_buffer *cb, size_t index)
 {
-  if (cb == NULL || cb->data == NULL || index >= cb->size)
+  if (cb == NULL || cb->styles_size == 0 || cb->styles[0].start > index)
   {
     return NULL;
   }
 
-  return &cb->data[index];
+  // last span starting at or before index
+  size_t lo = 0;
+  size_t hi = cb->styles_size;
+
+  while (lo + 1 < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+
+    if (cb->styles[mid].start <= index)
+    {
+      lo = mid;
+    }
+
+    else
+    {
+      hi = mid;
+    }
+  }
+
+  return &cb->styles[lo];
 }
 
 bool cb_init(cnc_buffer *cb, size_t max_capacity)
+{
+  return cb_init_with_allocator(cb, max_capacity, NULL);
+}
+
+bool cb_init_with_allocator(cnc_buffer *cb, size_t max_capacity,
+                            const cnc_allocator *allocator)
 {
   if (cb == NULL || max_capacity == 0)
   {
@@ -228,7 +468,8 @@ bool cb_init(cnc_buffer *cb, size_t max_capacity)
   size_t initial_capacity =
     max_capacity <= CB_INIT_CAP ? max_capacity : CB_INIT_CAP;
 
-  cb->data = malloc(initial_capacity * sizeof(*cb->data));
+  cb->allocator = allocator;
+  cb->data      = cal_alloc(allocator, initial_capacity * sizeof(*cb->data));
 
   if (cb->data == NULL)
   {
@@ -240,6 +481,14 @@ bool cb_init(cnc_buffer *cb, size_t max_capacity)
   cb->size         = 0;
   cb->capacity     = initial_capacity;
   cb->max_capacity = max_capacity;
+  cb->dropped      = 0;
+  cb->version      = 0;
+  cb->changes      = 0;
+  cb->lazy_width   = false;
+
+  cb->styles_size     = 0;
+  cb->styles_capacity = 0;
+  cb->styles          = NULL;
 
   return true;
 }
@@ -264,7 +513,8 @@ bool cb_insert(cnc_buffer *cb, const cnc_term_token token, size_t index)
         new_capacity = cb->max_capacity;
       }
 
-      void *new_data = realloc(cb->data, new_capacity * sizeof(cnc_term_token));
+      void *new_data = cal_realloc(cb->allocator, cb->data,
+                                   new_capacity * sizeof(cnc_term_token));
 
       if (new_data == NULL)
       {
@@ -282,6 +532,9 @@ bool cb_insert(cnc_buffer *cb, const cnc_term_token token, size_t index)
               (cb->size - 1) * sizeof(cnc_term_token));
 
       cb->size--;
+      cb->dropped++;
+
+      _cb_styles_drop(cb, 1);
 
       if (index > 0)
       {
@@ -295,10 +548,15 @@ bool cb_insert(cnc_buffer *cb, const cnc_term_token token, size_t index)
   {
     memmove(&cb->data[index + 1], &cb->data[index],
             (cb->size - index) * sizeof(cnc_term_token));
+
+    cb->version++;
   }
 
+  _cb_styles_insert(cb, index);
+
   cb->data[index] = token;
   cb->size++;
+  cb->changes++;
 
   return true;
 }
@@ -326,21 +584,31 @@ bool cb_locate_buffer(cnc_buffer *cb, cnc_buffer *search, size_t *location)
     return true;
   }
 
-  for (size_t i = 0; i <= buffer_length - search_length; i++)
+  cb_search cs;
+
+  cb_search_init(&cs, search);
+
+  return cb_search_next(&cs, cb, location);
+}
+
+bool cb_locate_c_str(cnc_buffer *cb, const char *str, size_t *location)
+{
+  if (cb == NULL || cb->data == NULL || str == NULL || location == NULL ||
+      *str == C_NUL)
   {
-    size_t j;
+    return false;
+  }
 
-    for (j = 0; j < search_length; j++)
-    {
-      if (ctt_equal(&cb->data[i + j], &search->data[j]) == false)
-      {
-        break;
-      }
-    }
+  uint8_t first = (uint8_t)str[0];
+  size_t  end_index;
 
-    if (j == search_length)
+  for (size_t i = 0; i < cb->size; i++)
+  {
+    // first byte prefilter before walking the rest of the string
+    if (cb->data[i].seq[0] == first && _cb_match_c_str(cb, i, str, &end_index))
     {
       *location = i;
+
       return true;
     }
   }
@@ -348,30 +616,33 @@ bool cb_locate_buffer(cnc_buffer *cb, cnc_buffer *search, size_t *location)
   return false;
 }
 
-bool cb_locate_c_str(cnc_buffer *cb, const char *str, size_t *location)
+bool cb_match_at(const cnc_buffer *cb, size_t index, const cnc_buffer *pattern)
 {
-  if (cb == NULL || cb->data == NULL || str == NULL || location == NULL)
+  if (cb == NULL || cb->data == NULL || pattern == NULL ||
+      pattern->data == NULL || index > cb->size ||
+      pattern->size > cb->size - index)
   {
     return false;
   }
 
-  cnc_buffer search;
-
-  if (cb_init(&search, strlen(str)) == false)
+  // cheap value compare first, full token compare only when values agree
+  for (size_t j = 0; j < pattern->size; j++)
   {
-    return false;
+    if (cb->data[index + j].token.value != pattern->data[j].token.value)
+    {
+      return false;
+    }
   }
 
-  if (cb_set_txt(&search, str) == false)
+  for (size_t j = 0; j < pattern->size; j++)
   {
-    return false;
+    if (ctt_equal(&cb->data[index + j], &pattern->data[j]) == false)
+    {
+      return false;
+    }
   }
 
-  bool return_value = cb_locate_buffer(cb, &search, location);
-
-  cb_destroy(&search);
-
-  return return_value;
+  return true;
 }
 
 bool cb_overwrite(cnc_buffer *dst, size_t dst_start, size_t length,
@@ -410,6 +681,9 @@ bool cb_overwrite(cnc_buffer *dst, size_t dst_start, size_t length,
   memcpy(&dst->data[dst_start], &src->data[src_start],
          actual_length * sizeof(cnc_term_token));
 
+  dst->version++;
+  dst->changes++;
+
   return true;
 }
 
@@ -424,6 +698,7 @@ bool cb_push(cnc_buffer *cb, const cnc_term_token token)
   if (cb->size < cb->capacity)
   {
     cb->data[cb->size++] = token;
+    cb->changes++;
 
     return true;
   }
@@ -439,8 +714,8 @@ bool cb_push(cnc_buffer *cb, const cnc_term_token token)
       new_capacity = cb->max_capacity;
     }
 
-    cnc_term_token *new_data =
-      realloc(cb->data, new_capacity * sizeof(cnc_term_token));
+    cnc_term_token *new_data = cal_realloc(
+      cb->allocator, cb->data, new_capacity * sizeof(cnc_term_token));
 
     if (new_data == NULL)
     {
@@ -458,6 +733,7 @@ bool cb_push(cnc_buffer *cb, const cnc_term_token token)
   }
 
   cb->data[cb->size++] = token;
+  cb->changes++;
 
   return true;
 }
@@ -469,13 +745,16 @@ bool cb_remove(cnc_buffer *cb, size_t index)
     return false;
   }
 
-  if (index < cb->size - 1)
-  {
-    memmove(&cb->data[index], &cb->data[index + 1],
-            (cb->size - index - 1) * sizeof(cnc_term_token));
-  }
+  memmove(&cb->data[index], &cb->data[index + 1],
+          (cb->size - index - 1) * sizeof(cnc_term_token));
 
+  // even the last token: a token appended in its place before readers
+  // look again would otherwise pass for the one removed
   cb->size--;
+  cb->version++;
+  cb->changes++;
+
+  _cb_styles_remove(cb, index);
 
   return true;
 }
@@ -499,6 +778,12 @@ bool cb_replace(cnc_buffer *cb, const cnc_term_token *match,
     }
   }
 
+  if (replaced)
+  {
+    cb->version++;
+    cb->changes++;
+  }
+
   return replaced;
 }
 
@@ -519,7 +804,8 @@ bool cb_resize(cnc_buffer *cb, size_t new_capacity)
     return true; // Nothing to do
   }
 
-  cnc_term_token *new_data = malloc(new_capacity * sizeof(*new_data));
+  cnc_term_token *new_data =
+    cal_alloc(cb->allocator, new_capacity * sizeof(*new_data));
 
   if (new_data == NULL)
   {
@@ -531,15 +817,109 @@ bool cb_resize(cnc_buffer *cb, size_t new_capacity)
 
   memcpy(new_data, cb->data, to_copy * sizeof(cnc_term_token));
 
-  free(cb->data);
+  cal_free(cb->allocator, cb->data);
+
+  // truncated tokens are removed ones (cb_remove)
+  if (to_copy < cb->size)
+  {
+    cb->version++;
+  }
 
   cb->data     = new_data;
   cb->capacity = new_capacity;
   cb->size     = to_copy;
+  cb->changes++;
+
+  // drop styles of truncated tokens
+  while (cb->styles_size > 0 &&
+         cb->styles[cb->styles_size - 1].start > cb->size)
+  {
+    cb->styles_size--;
+  }
 
   return true;
 }
 
+void cb_search_init(cb_search *cs, const cnc_buffer *pattern)
+{
+  if (cs == NULL)
+  {
+    return;
+  }
+
+  cs->pattern  = pattern;
+  cs->position = 0;
+
+  size_t m = (pattern == NULL || pattern->data == NULL) ? 0 : pattern->size;
+
+  for (size_t i = 0; i < CB_SEARCH_SHIFT_SIZE; i++)
+  {
+    cs->shift[i] = m;
+  }
+
+  // last token is left out: a mismatch on it must still shift by at least 1.
+  // colliding values keep the smallest shift, so the table stays safe.
+  for (size_t i = 0; i + 1 < m; i++)
+  {
+    cs->shift[_cb_search_hash(pattern->data[i].token.value)] = m - 1 - i;
+  }
+}
+
+bool cb_search_next(cb_search *cs, const cnc_buffer *cb, size_t *location)
+{
+  if (cs == NULL || cs->pattern == NULL || cs->pattern->data == NULL ||
+      cb == NULL || cb->data == NULL || location == NULL)
+  {
+    return false;
+  }
+
+  const cnc_buffer *pattern = cs->pattern;
+  size_t            m       = pattern->size;
+
+  if (m == 0)
+  {
+    // empty pattern matches once, at the current position
+    if (cs->position > cb->size)
+    {
+      return false;
+    }
+
+    *location    = cs->position;
+    cs->position = cb->size + 1;
+
+    return true;
+  }
+
+  if (cb->size < m)
+  {
+    return false;
+  }
+
+  uint32_t first = pattern->data[0].token.value;
+  uint32_t last  = pattern->data[m - 1].token.value;
+  size_t   i     = cs->position;
+
+  while (i <= cb->size - m)
+  {
+    uint32_t value = cb->data[i + m - 1].token.value;
+
+    if (value == last && cb->data[i].token.value == first &&
+        cb_match_at(cb, i, pattern))
+    {
+      *location    = i;
+      cs->position = i + 1;
+
+      return true;
+    }
+
+    i += cs->shift[_cb_search_hash(value)];
+  }
+
+  cs->position = i;
+
+  return false;
+}
+
 bool cb_set(cnc_buffer *cb, const cnc_term_token token, size_t index)
 {
   if (cb == NULL || cb->data == NULL)
@@ -548,6 +928,8 @@ bool cb_set(cnc_buffer *cb, const cnc_term_token token, size_t index)
   }
 
   cb->data[index] = token;
+  cb->version++;
+  cb->changes++;
 
   return true;
 }
@@ -564,6 +946,88 @@ bool cb_set_buf(cnc_buffer *dst, cnc_buffer *src)
   return cb_append_buf(dst, src);
 }
 
+bool cb_set_max_capacity(cnc_buffer *cb, size_t max_capacity)
+{
+  if (cb == NULL || cb->data == NULL || max_capacity == 0)
+  {
+    return false;
+  }
+
+  // the oldest tokens are evicted, as if the buffer had scrolled
+  if (cb->size > max_capacity)
+  {
+    _cb_drop(cb, cb->size - max_capacity);
+  }
+
+  if (cb->capacity > max_capacity)
+  {
+    cnc_term_token *new_data = cal_realloc(
+      cb->allocator, cb->data, max_capacity * sizeof(cnc_term_token));
+
+    if (new_data == NULL)
+    {
+      return false;
+    }
+
+    cb->data     = new_data;
+    cb->capacity = max_capacity;
+  }
+
+  cb->max_capacity = max_capacity;
+
+  return true;
+}
+
+bool cb_set_style(cnc_buffer *cb, cnc_style style)
+{
+  if (cb == NULL || cb->data == NULL)
+  {
+    return false;
+  }
+
+  // style of the tokens appended from now on
+  if (cb->styles_size > 0)
+  {
+    cb_style_span *last = &cb->styles[cb->styles_size - 1];
+
+    if (last->style == style)
+    {
+      return true;
+    }
+
+    // nothing was appended since the last change: replace it
+    if (last->start == cb->size)
+    {
+      last->style = style;
+      cb->changes++;
+
+      if (cb->styles_size > 1 && (last - 1)->style == style)
+      {
+        cb->styles_size--;
+      }
+
+      return true;
+    }
+  }
+
+  else if (style == CS_DEFAULT)
+  {
+    return true;
+  }
+
+  if (_cb_styles_reserve(cb, cb->styles_size + 1) == false)
+  {
+    return false;
+  }
+
+  cb_style_span span = {cb->size, style};
+
+  cb->styles[cb->styles_size++] = span;
+  cb->changes++;
+
+  return true;
+}
+
 bool cb_set_txt(cnc_buffer *cb, const char *text)
 {
   if (cb == NULL || cb->data == NULL || text == NULL)
@@ -613,3 +1077,16 @@ bool cb_set_c_str(cnc_buffer *cb, char *dst, size_t dst_size)
 
   return true;
 }
+
+void cb_usage(const cnc_buffer *cb, cal_usage *usage)
+{
+  if (cb == NULL || usage == NULL)
+  {
+    return;
+  }
+
+  usage->used += cb->size * sizeof(*cb->data) +
+                 cb->styles_size * sizeof(*cb->styles);
+  usage->reserved += cb->capacity * sizeof(*cb->data) +
+                     cb->styles_capacity * sizeof(*cb->styles);
+}
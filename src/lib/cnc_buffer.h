@@ -7,7 +7,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "cnc_allocator.h"
+#include "cnc_style.h"
 #include "cnc_term_token.h"
+#include "cnc_trace.h"
 
 // delete 25% when full
 #define CB_SCROLL_FACTOR 4
@@ -15,18 +18,69 @@
 // define buffer initial capacity
 #define CB_INIT_CAP 256
 
+// bad token shift table size used by the search engine (power of 2)
+#define CB_SEARCH_SHIFT_SIZE 256
+
+// style spans table initial capacity
+#define CB_STYLES_INIT_CAP 8
+
+// style span: tokens from start up to the next span's start use style
+typedef struct
+{
+  size_t    start;
+  cnc_style style;
+
+} cb_style_span;
+
 typedef struct
 {
   size_t size;
   size_t capacity;
   size_t max_capacity;
 
+  // dropped: tokens evicted from the front since init (scroll).
+  // dropped + i is the absolute position of data[i].
+  size_t dropped;
+
+  // version: bumped whenever tokens are changed or removed, so derived
+  // structures know they cannot be updated incrementally
+  size_t version;
+
+  // changes: bumped by every change of the tokens or their styles, appends
+  // included. a reader that saw as many changes saw the same buffer
+  size_t changes;
+
+  const cnc_allocator *allocator; // NULL: malloc/realloc/free
+
+  // lazy_width: appended text is stored with W_UNK widths, computed and
+  // cached the first time the tokens are measured (cb_data_width)
+  bool lazy_width;
+
   cnc_term_token *data;
 
+  // styles live outside of the text: spans sorted by start, kept in sync
+  // on insert, remove and scroll. text before the first span is unstyled.
+  size_t         styles_size;
+  size_t         styles_capacity;
+  cb_style_span *styles;
+
 } cnc_buffer;
 
+// search state: Boyer-Moore-Horspool over token values.
+// initialize with cb_search_init, then call cb_search_next repeatedly
+// to get every match (overlapping matches included) in increasing order.
+typedef struct
+{
+  const cnc_buffer *pattern;
+  size_t            position; // next candidate start index
+
+  size_t shift[CB_SEARCH_SHIFT_SIZE]; // hashed bad token shifts
+
+} cb_search;
+
 // functions
 bool   cb_append_buf(cnc_buffer *dst, const cnc_buffer *src);
+bool   cb_append_bytes(cnc_buffer *cb, const char *bytes, size_t length);
 bool   cb_append_txt(cnc_buffer *cb, const char *text);
 void   cb_clear(cnc_buffer *cb);
 size_t cb_data_length(cnc_buffer *cb, size_t start_index, size_t count);
@@ -36,11 +90,15 @@ bool   cb_equal(cnc_buffer *cb, cnc_buffer *match);
 bool   cb_equal_c_str(cnc_buffer *cb, char *str);
 
 const cnc_term_token *cb_get(const cnc_buffer *cb, size_t index);
+const cb_style_span  *cb_get_style(const cnc_buffer *cb, size_t index);
 
 bool cb_init(cnc_buffer *cb, size_t max_capacity);
+bool cb_init_with_allocator(cnc_buffer *cb, size_t max_capacity,
+                            const cnc_allocator *allocator);
 bool cb_insert(cnc_buffer *cb, const cnc_term_token token, size_t index);
 bool cb_locate_buffer(cnc_buffer *cb, cnc_buffer *search, size_t *location);
 bool cb_locate_c_str(cnc_buffer *cb, const char *str, size_t *location);
+bool cb_match_at(const cnc_buffer *cb, size_t index, const cnc_buffer *pattern);
 bool cb_overwrite(cnc_buffer *dst, size_t dst_start, size_t length,
                   cnc_buffer *src, size_t src_start);
 bool cb_push(cnc_buffer *cb, const cnc_term_token token);
@@ -48,9 +106,14 @@ bool cb_remove(cnc_buffer *cb, size_t index);
 bool cb_replace(cnc_buffer *cb, const cnc_term_token *match,
                 const cnc_term_token *replacement);
 bool cb_resize(cnc_buffer *cb, size_t new_capacity);
+void cb_search_init(cb_search *cs, const cnc_buffer *pattern);
+bool cb_search_next(cb_search *cs, const cnc_buffer *cb, size_t *location);
 bool cb_set(cnc_buffer *cb, const cnc_term_token token, size_t index);
 bool cb_set_buf(cnc_buffer *dst, cnc_buffer *src);
+bool cb_set_max_capacity(cnc_buffer *cb, size_t max_capacity);
+bool cb_set_style(cnc_buffer *cb, cnc_style style);
 bool cb_set_txt(cnc_buffer *cb, const char *text);
 bool cb_set_c_str(cnc_buffer *cb, char *dst, size_t dst_size);
+void cb_usage(const cnc_buffer *cb, cal_usage *usage);
 
 #endif
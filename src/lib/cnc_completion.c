@@ -0,0 +1,424 @@
+#include "cnc_completion.h"
+
+// private functions declaration
+static uint32_t _ccp_child(const cnc_completion *ccp, uint32_t node,
+                           uint8_t byte, uint32_t *prev);
+static bool     _ccp_copy(const cnc_completion *ccp, uint32_t node,
+                          size_t offset, char *dst, size_t dst_size,
+                          size_t *length);
+static uint32_t _ccp_node(cnc_completion *ccp, uint32_t label, uint32_t length);
+static bool     _ccp_reserve(cnc_completion *ccp, size_t nodes, size_t bytes);
+
+// private functions definition
+static uint32_t _ccp_child(const cnc_completion *ccp, uint32_t node,
+                           uint8_t byte, uint32_t *prev)
+{
+  // children are sorted: prev is the last one before byte
+  uint32_t child = ccp->nodes[node].child;
+  uint32_t last  = CCP_NONE;
+
+  while (child != CCP_NONE)
+  {
+    uint8_t first = (uint8_t)ccp->bytes[ccp->nodes[child].label];
+
+    if (first >= byte)
+    {
+      break;
+    }
+
+    last  = child;
+    child = ccp->nodes[child].sibling;
+  }
+
+  if (prev != NULL)
+  {
+    *prev = last;
+  }
+
+  if (child != CCP_NONE &&
+      (uint8_t)ccp->bytes[ccp->nodes[child].label] == byte)
+  {
+    return child;
+  }
+
+  return CCP_NONE;
+}
+
+static bool _ccp_copy(const cnc_completion *ccp, uint32_t node,
+                      size_t offset, char *dst, size_t dst_size,
+                      size_t *length)
+{
+  // the label from offset on, after the length bytes of dst
+  const ccp_node *n     = &ccp->nodes[node];
+  size_t          bytes = n->length - offset;
+
+  if (*length + bytes >= dst_size)
+  {
+    return false;
+  }
+
+  memcpy(dst + *length, ccp->bytes + n->label + offset, bytes);
+
+  *length += bytes;
+  dst[*length] = '\0';
+
+  return true;
+}
+
+static uint32_t _ccp_node(cnc_completion *ccp, uint32_t label, uint32_t length)
+{
+  // room was reserved by the caller
+  uint32_t  index = (uint32_t)ccp->nodes_size++;
+  ccp_node *node  = &ccp->nodes[index];
+
+  node->label    = label;
+  node->length   = length;
+  node->child    = CCP_NONE;
+  node->sibling  = CCP_NONE;
+  node->count    = 0;
+  node->terminal = false;
+
+  return index;
+}
+
+static bool _ccp_reserve(cnc_completion *ccp, size_t nodes, size_t bytes)
+{
+  if (ccp->nodes_size + nodes > ccp->nodes_capacity)
+  {
+    size_t new_capacity = ccp->nodes_capacity * 2;
+
+    while (new_capacity < ccp->nodes_size + nodes)
+    {
+      new_capacity *= 2;
+    }
+
+    ccp_node *new_nodes = cal_realloc(ccp->allocator, ccp->nodes,
+                                      new_capacity * sizeof(*new_nodes));
+
+    if (new_nodes == NULL)
+    {
+      return false;
+    }
+
+    ccp->nodes          = new_nodes;
+    ccp->nodes_capacity = new_capacity;
+  }
+
+  if (ccp->bytes_size + bytes > ccp->bytes_capacity)
+  {
+    size_t new_capacity = ccp->bytes_capacity * 2;
+
+    while (new_capacity < ccp->bytes_size + bytes)
+    {
+      new_capacity *= 2;
+    }
+
+    char *new_bytes = cal_realloc(ccp->allocator, ccp->bytes, new_capacity);
+
+    if (new_bytes == NULL)
+    {
+      return false;
+    }
+
+    ccp->bytes          = new_bytes;
+    ccp->bytes_capacity = new_capacity;
+  }
+
+  return true;
+}
+
+// main functions
+bool ccp_add(cnc_completion *ccp, const char *text, size_t length)
+{
+  if (ccp == NULL || text == NULL || length == 0 || length >= CCP_TEXT_MAX)
+  {
+    return false;
+  }
+
+  ccp_match match;
+
+  // already there: counts stay as they are
+  if (ccp_find(ccp, text, length, &match) &&
+      match.offset == ccp->nodes[match.node].length &&
+      ccp->nodes[match.node].terminal)
+  {
+    return true;
+  }
+
+  // at worst a split and a new leaf
+  if (_ccp_reserve(ccp, 2, length) == false)
+  {
+    return false;
+  }
+
+  uint32_t node = 0;
+  size_t   i    = 0;
+
+  ccp->nodes[0].count++;
+
+  while (i < length)
+  {
+    uint32_t prev  = CCP_NONE;
+    uint32_t child = _ccp_child(ccp, node, (uint8_t)text[i], &prev);
+
+    // nothing shares the rest of the text: a new leaf holds it
+    if (child == CCP_NONE)
+    {
+      uint32_t leaf = _ccp_node(ccp, (uint32_t)ccp->bytes_size,
+                                (uint32_t)(length - i));
+
+      memcpy(ccp->bytes + ccp->bytes_size, text + i, length - i);
+      ccp->bytes_size += length - i;
+
+      ccp->nodes[leaf].count    = 1;
+      ccp->nodes[leaf].terminal = true;
+
+      if (prev == CCP_NONE)
+      {
+        ccp->nodes[leaf].sibling = ccp->nodes[node].child;
+        ccp->nodes[node].child   = leaf;
+      }
+
+      else
+      {
+        ccp->nodes[leaf].sibling = ccp->nodes[prev].sibling;
+        ccp->nodes[prev].sibling = leaf;
+      }
+
+      return true;
+    }
+
+    ccp_node *c      = &ccp->nodes[child];
+    size_t    common = 1;
+
+    while (common < c->length && i + common < length &&
+           ccp->bytes[c->label + common] == text[i + common])
+    {
+      common++;
+    }
+
+    // the text leaves the label: the label is split where it does
+    if (common < c->length)
+    {
+      uint32_t tail = _ccp_node(ccp, c->label + (uint32_t)common,
+                                c->length - (uint32_t)common);
+
+      c = &ccp->nodes[child];
+
+      ccp->nodes[tail].child    = c->child;
+      ccp->nodes[tail].count    = c->count;
+      ccp->nodes[tail].terminal = c->terminal;
+
+      c->length   = (uint32_t)common;
+      c->child    = tail;
+      c->terminal = false;
+    }
+
+    c->count++;
+    node = child;
+    i += common;
+  }
+
+  ccp->nodes[node].terminal = true;
+
+  return true;
+}
+
+void ccp_clear(cnc_completion *ccp)
+{
+  if (ccp == NULL || ccp->nodes == NULL)
+  {
+    return;
+  }
+
+  // the root only, memory is kept for the next set
+  ccp->nodes_size = 0;
+  ccp->bytes_size = 0;
+
+  _ccp_node(ccp, 0, 0);
+}
+
+size_t ccp_common(const cnc_completion *ccp, const ccp_match *match,
+                  char *dst, size_t dst_size)
+{
+  if (ccp == NULL || match == NULL || dst == NULL || dst_size == 0 ||
+      match->count == 0)
+  {
+    return 0;
+  }
+
+  size_t length = 0;
+
+  dst[0] = '\0';
+
+  // every match goes on with the rest of the label
+  if (_ccp_copy(ccp, match->node, match->offset, dst, dst_size, &length) ==
+      false)
+  {
+    return 0;
+  }
+
+  return length;
+}
+
+void ccp_destroy(cnc_completion *ccp)
+{
+  if (ccp == NULL)
+  {
+    return;
+  }
+
+  cal_free(ccp->allocator, ccp->nodes);
+  cal_free(ccp->allocator, ccp->bytes);
+
+  memset(ccp, 0, sizeof(*ccp));
+}
+
+bool ccp_find(const cnc_completion *ccp, const char *prefix, size_t length,
+              ccp_match *match)
+{
+  if (ccp == NULL || ccp->nodes == NULL || prefix == NULL || match == NULL)
+  {
+    return false;
+  }
+
+  uint32_t node   = 0;
+  size_t   offset = 0;
+  size_t   i      = 0;
+
+  match->node   = CCP_NONE;
+  match->offset = 0;
+  match->count  = 0;
+
+  while (i < length)
+  {
+    node = _ccp_child(ccp, node, (uint8_t)prefix[i], NULL);
+
+    if (node == CCP_NONE)
+    {
+      return false;
+    }
+
+    const ccp_node *n = &ccp->nodes[node];
+
+    // the prefix may end within the label
+    for (offset = 1; offset < n->length && i + offset < length; offset++)
+    {
+      if (ccp->bytes[n->label + offset] != prefix[i + offset])
+      {
+        return false;
+      }
+    }
+
+    i += offset;
+  }
+
+  match->node   = node;
+  match->offset = offset;
+  match->count  = ccp->nodes[node].count;
+
+  return match->count > 0;
+}
+
+size_t ccp_get(const cnc_completion *ccp, const ccp_match *match,
+               size_t index, char *dst, size_t dst_size)
+{
+  if (ccp == NULL || match == NULL || dst == NULL || dst_size == 0 ||
+      index >= match->count)
+  {
+    return 0;
+  }
+
+  // the bytes after the prefix of the match at index, in byte order: a
+  // candidate comes before the longer ones it starts, and the counts skip
+  // whole subtrees
+  uint32_t node   = match->node;
+  size_t   length = 0;
+
+  dst[0] = '\0';
+
+  if (_ccp_copy(ccp, node, match->offset, dst, dst_size, &length) == false)
+  {
+    return 0;
+  }
+
+  for (;;)
+  {
+    const ccp_node *n = &ccp->nodes[node];
+
+    if (n->terminal)
+    {
+      if (index == 0)
+      {
+        return length;
+      }
+
+      index--;
+    }
+
+    uint32_t child = n->child;
+
+    while (child != CCP_NONE && index >= ccp->nodes[child].count)
+    {
+      index -= ccp->nodes[child].count;
+      child = ccp->nodes[child].sibling;
+    }
+
+    if (child == CCP_NONE)
+    {
+      return 0;
+    }
+
+    // too long for dst
+    if (_ccp_copy(ccp, child, 0, dst, dst_size, &length) == false)
+    {
+      dst[0] = '\0';
+
+      return 0;
+    }
+
+    node = child;
+  }
+}
+
+bool ccp_init(cnc_completion *ccp, const cnc_allocator *allocator)
+{
+  if (ccp == NULL)
+  {
+    return false;
+  }
+
+  memset(ccp, 0, sizeof(*ccp));
+
+  ccp->allocator = allocator;
+  ccp->nodes =
+    cal_alloc(allocator, CCP_NODES_INIT_CAP * sizeof(*ccp->nodes));
+  ccp->bytes = cal_alloc(allocator, CCP_BYTES_INIT_CAP);
+
+  if (ccp->nodes == NULL || ccp->bytes == NULL)
+  {
+    ccp_destroy(ccp);
+
+    return false;
+  }
+
+  ccp->nodes_capacity = CCP_NODES_INIT_CAP;
+  ccp->bytes_capacity = CCP_BYTES_INIT_CAP;
+
+  // the root: the empty prefix of every candidate
+  _ccp_node(ccp, 0, 0);
+
+  return true;
+}
+
+void ccp_usage(const cnc_completion *ccp, cal_usage *usage)
+{
+  if (ccp == NULL || usage == NULL)
+  {
+    return;
+  }
+
+  usage->used += ccp->nodes_size * sizeof(*ccp->nodes) + ccp->bytes_size;
+  usage->reserved +=
+    ccp->nodes_capacity * sizeof(*ccp->nodes) + ccp->bytes_capacity;
+}
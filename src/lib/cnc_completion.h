@@ -0,0 +1,85 @@
+#ifndef CNC_COMPLETION_H
+#define CNC_COMPLETION_H
+
+// using ccp as shorthand for cnc_completion
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cnc_allocator.h"
+
+// nodes and label bytes a candidate set starts with
+#define CCP_NODES_INIT_CAP 64
+#define CCP_BYTES_INIT_CAP 1024
+
+// bytes of a candidate, '\0' included
+#define CCP_TEXT_MAX 1024
+
+// no node
+#define CCP_NONE UINT32_MAX
+
+// candidate set (commands, file names, identifiers) in a radix trie: a
+// node holds the bytes its candidates share after its parent, and counts
+// the candidates below it. nodes live in one array and their labels in one
+// byte pool, children are sorted by their first byte.
+//
+// ccp_find walks the prefix once. all its matches share the rest of the
+// label it stops in (ccp_common), and the counts lead straight to the
+// match at any index (ccp_get): listing the visible matches costs the
+// prefix length plus the matches listed, whatever the set size.
+
+typedef struct
+{
+  uint32_t label;    // first byte of the label in the byte pool
+  uint32_t length;   // bytes of the label
+  uint32_t child;    // first child
+  uint32_t sibling;  // next child of the parent
+  uint32_t count;    // candidates ending here or below
+  bool     terminal; // a candidate ends here
+
+} ccp_node;
+
+// matches of a prefix
+typedef struct
+{
+  uint32_t node;   // node the prefix ends in
+  size_t   offset; // bytes of its label within the prefix
+  size_t   count;  // candidates starting with the prefix
+
+} ccp_match;
+
+typedef struct
+{
+  ccp_node *nodes; // nodes[0] is the root, with an empty label
+  size_t    nodes_size;
+  size_t    nodes_capacity;
+
+  char  *bytes;
+  size_t bytes_size;
+  size_t bytes_capacity;
+
+  const cnc_allocator *allocator;
+
+} cnc_completion;
+
+// main functions
+bool ccp_add(cnc_completion *ccp, const char *text, size_t length);
+void ccp_clear(cnc_completion *ccp);
+
+size_t ccp_common(const cnc_completion *ccp, const ccp_match *match,
+                  char *dst, size_t dst_size);
+
+void ccp_destroy(cnc_completion *ccp);
+bool ccp_find(const cnc_completion *ccp, const char *prefix, size_t length,
+              ccp_match *match);
+
+size_t ccp_get(const cnc_completion *ccp, const ccp_match *match,
+               size_t index, char *dst, size_t dst_size);
+
+bool ccp_init(cnc_completion *ccp, const cnc_allocator *allocator);
+void ccp_usage(const cnc_completion *ccp, cal_usage *usage);
+
+#endif
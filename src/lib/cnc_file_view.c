@@ -0,0 +1,681 @@
+#include "cnc_file_view.h"
+
+// shown for bytes that are not valid UTF-8
+#define CFV_REPLACEMENT 0xFFFD
+
+// bytes a row may draw per cell: zero width characters stack up
+#define CFV_CELL_BYTES 4
+
+// the guard a SIGBUS of this thread jumps to, NULL outside cfv_guard, and
+// the handler cfv_guard replaced, for the faults that are not its own
+static __thread sigjmp_buf *cfv_fault;
+static struct sigaction     cfv_fault_next;
+
+// private functions declaration
+static size_t _cfv_boundary(const cnc_file_view *cfv, size_t offset);
+static bool   _cfv_breaks(const cnc_file_view *cfv, size_t segment);
+static void   _cfv_fault(int signal);
+static size_t _cfv_origin(const cnc_file_view *cfv, size_t offset);
+static bool   _cfv_reserve(cnc_file_view *cfv, size_t count);
+static size_t _cfv_row_of(const cnc_file_view *cfv, size_t offset,
+                          size_t width);
+
+// private functions definition
+static size_t _cfv_boundary(const cnc_file_view *cfv, size_t offset)
+{
+  // the first character starting at offset or after it
+  for (size_t i = 0; i < 3 && offset < cfv->size &&
+                     ((uint8_t)cfv->map[offset] & 0xC0) == 0x80;
+       i++)
+  {
+    offset++;
+  }
+
+  return offset;
+}
+
+static bool _cfv_breaks(const cnc_file_view *cfv, size_t segment)
+{
+  // the line crossing the segment start began a whole segment before it
+  return memrchr(cfv->map + segment - CFV_SEGMENT, '\n', CFV_SEGMENT) == NULL;
+}
+
+static void _cfv_fault(int signal)
+{
+  // a fault outside a guard is raised again with the handler before it
+  if (cfv_fault == NULL)
+  {
+    sigaction(signal, &cfv_fault_next, NULL);
+
+    return;
+  }
+
+  siglongjmp(*cfv_fault, 1);
+}
+
+static size_t _cfv_origin(const cnc_file_view *cfv, size_t offset)
+{
+  // where the rows holding offset are wrapped from: the start of its line,
+  // or the segment start a long line breaks at
+  size_t      segment = offset / CFV_SEGMENT * CFV_SEGMENT;
+  const char *feed    = NULL;
+
+  if (offset > segment)
+  {
+    feed = memrchr(cfv->map + segment, '\n', offset - segment);
+  }
+
+  if (feed != NULL)
+  {
+    return (size_t)(feed - cfv->map) + 1;
+  }
+
+  if (segment == 0)
+  {
+    return 0;
+  }
+
+  if (_cfv_breaks(cfv, segment))
+  {
+    size_t start = _cfv_boundary(cfv, segment);
+
+    // offset is in a character started before the segment
+    return start <= offset ? start : _cfv_origin(cfv, segment - 1);
+  }
+
+  feed = memrchr(cfv->map + segment - CFV_SEGMENT, '\n', CFV_SEGMENT);
+
+  return (size_t)(feed - cfv->map) + 1;
+}
+
+static bool _cfv_reserve(cnc_file_view *cfv, size_t count)
+{
+  if (cfv->marks_size + count <= cfv->marks_capacity)
+  {
+    return true;
+  }
+
+  size_t new_capacity = cfv->marks_capacity * 2;
+
+  while (new_capacity < cfv->marks_size + count)
+  {
+    new_capacity *= 2;
+  }
+
+  size_t *new_marks = cal_realloc(cfv->allocator, cfv->marks,
+                                  new_capacity * sizeof(*new_marks));
+
+  if (new_marks == NULL)
+  {
+    return false;
+  }
+
+  cfv->marks          = new_marks;
+  cfv->marks_capacity = new_capacity;
+
+  return true;
+}
+
+static size_t _cfv_row_of(const cnc_file_view *cfv, size_t offset,
+                          size_t width)
+{
+  // start of the row holding offset, a line feed belongs to its last row
+  size_t row = _cfv_origin(cfv, offset);
+
+  for (;;)
+  {
+    size_t next = cfv_row(cfv, row, width, NULL);
+
+    if (next > offset || next == row)
+    {
+      return row;
+    }
+
+    row = next;
+  }
+}
+
+// main functions
+void cfv_close(cnc_file_view *cfv)
+{
+  if (cfv == NULL)
+  {
+    return;
+  }
+
+  if (cfv->map != NULL)
+  {
+    munmap((void *)cfv->map, cfv->mapped);
+  }
+
+  if (cfv->fd >= 0)
+  {
+    close(cfv->fd);
+  }
+
+  cal_free(cfv->allocator, cfv->marks);
+  cal_free(cfv->allocator, cfv->chunk);
+
+  // ready to open another file
+  cfv_init(cfv, cfv->allocator);
+}
+
+bool cfv_guard(cnc_file_view *cfv, size_t *row, void (*read)(void *context),
+               void *context)
+{
+  if (cfv == NULL || row == NULL || read == NULL)
+  {
+    return false;
+  }
+
+  /*
+   * read(context) reads the map with SIGBUS caught: a page past the end of
+   * a file cut since the last cfv_sync jumps back here instead of killing
+   * the process. the file is measured again and false is returned, what
+   * read did is to be thrown away. the handler is only set for the call,
+   * and left unblocked (SA_NODEFER) since the jump skips its return.
+   */
+  struct sigaction guard;
+  sigjmp_buf       jump;
+  bool             read_all = false;
+
+  memset(&guard, 0, sizeof(guard));
+  guard.sa_handler = _cfv_fault;
+  guard.sa_flags   = SA_NODEFER;
+  sigemptyset(&guard.sa_mask);
+
+  if (sigaction(SIGBUS, &guard, &cfv_fault_next) == -1)
+  {
+    return false;
+  }
+
+  if (sigsetjmp(jump, 0) == 0)
+  {
+    cfv_fault = &jump;
+    read(context);
+    read_all = true;
+  }
+
+  cfv_fault = NULL;
+  sigaction(SIGBUS, &cfv_fault_next, NULL);
+
+  if (read_all == false)
+  {
+    cfv_sync(cfv, row);
+  }
+
+  return read_all;
+}
+
+bool cfv_index(cnc_file_view *cfv, size_t budget)
+{
+  if (cfv == NULL || cfv->chunk == NULL)
+  {
+    return false;
+  }
+
+  while (budget > 0 && cfv->indexed < cfv->size)
+  {
+    size_t left   = cfv->size - cfv->indexed;
+    size_t length = left < CFV_INDEX_CHUNK ? left : CFV_INDEX_CHUNK;
+
+    // room for the marks of a whole chunk, before any line is counted
+    if (_cfv_reserve(cfv, CFV_INDEX_CHUNK / CFV_INDEX_STEP + 1) == false)
+    {
+      return false;
+    }
+
+    // read, not mapped: the scanned pages do not stay with the process
+    ssize_t got = pread(cfv->fd, cfv->chunk, length, (off_t)cfv->indexed);
+
+    if (got <= 0)
+    {
+      return false;
+    }
+
+    const char *end = cfv->chunk + got;
+
+    for (const char *p = cfv->chunk; (p = memchr(p, '\n', end - p)) != NULL;
+         p++)
+    {
+      cfv->lines++;
+
+      if (cfv->lines % CFV_INDEX_STEP == 0)
+      {
+        cfv->marks[cfv->marks_size++] = cfv->indexed + (p - cfv->chunk) + 1;
+      }
+    }
+
+    cfv->indexed += (size_t)got;
+    budget = (size_t)got < budget ? budget - (size_t)got : 0;
+  }
+
+  return cfv->indexed < cfv->size;
+}
+
+void cfv_init(cnc_file_view *cfv, const cnc_allocator *allocator)
+{
+  if (cfv == NULL)
+  {
+    return;
+  }
+
+  memset(cfv, 0, sizeof(*cfv));
+
+  cfv->fd        = -1;
+  cfv->allocator = allocator;
+}
+
+size_t cfv_line(const cnc_file_view *cfv, size_t offset)
+{
+  if (cfv == NULL || cfv->marks == NULL || offset > cfv->indexed)
+  {
+    return CFV_NONE;
+  }
+
+  // the last mark at or before offset, then the line feeds after it
+  size_t low  = 0;
+  size_t high = cfv->marks_size;
+
+  while (high - low > 1)
+  {
+    size_t middle = low + (high - low) / 2;
+
+    if (cfv->marks[middle] <= offset)
+    {
+      low = middle;
+    }
+
+    else
+    {
+      high = middle;
+    }
+  }
+
+  size_t      line = low * CFV_INDEX_STEP;
+  const char *p    = cfv->map + cfv->marks[low];
+  const char *end  = cfv->map + offset;
+
+  while (p < end && (p = memchr(p, '\n', end - p)) != NULL)
+  {
+    line++;
+    p++;
+  }
+
+  return line;
+}
+
+size_t cfv_line_start(cnc_file_view *cfv, size_t line)
+{
+  if (cfv == NULL || cfv->marks == NULL)
+  {
+    return CFV_NONE;
+  }
+
+  // the index is read up to the line first
+  while (cfv->lines < line && cfv_index(cfv, CFV_INDEX_CHUNK))
+  {
+  }
+
+  if (line > cfv->lines)
+  {
+    return CFV_NONE;
+  }
+
+  size_t offset = cfv->marks[line / CFV_INDEX_STEP];
+
+  for (size_t i = line % CFV_INDEX_STEP; i > 0; i--)
+  {
+    const char *feed = memchr(cfv->map + offset, '\n', cfv->size - offset);
+
+    offset = (size_t)(feed - cfv->map) + 1;
+  }
+
+  return offset;
+}
+
+void cfv_move(const cnc_file_view *cfv, size_t *row, ptrdiff_t delta,
+              size_t width)
+{
+  if (cfv == NULL || row == NULL || *row > cfv->size)
+  {
+    return;
+  }
+
+  // the last row is as far down as it goes
+  while (delta > 0)
+  {
+    size_t next = cfv_row(cfv, *row, width, NULL);
+
+    if (next >= cfv->size)
+    {
+      break;
+    }
+
+    *row = next;
+    delta--;
+  }
+
+  while (delta < 0 && *row > 0)
+  {
+    *row = _cfv_row_of(cfv, *row - 1, width);
+    delta++;
+  }
+}
+
+bool cfv_open(cnc_file_view *cfv, const char *path)
+{
+  if (cfv == NULL || path == NULL)
+  {
+    return false;
+  }
+
+  cfv_close(cfv);
+
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st;
+
+  if (fstat(fd, &st) < 0 || S_ISREG(st.st_mode) == false)
+  {
+    close(fd);
+
+    return false;
+  }
+
+  cfv->fd   = fd;
+  cfv->size = (size_t)st.st_size;
+
+  // pages are only read when a row needs them, from the file as it is then
+  if (cfv->size > 0)
+  {
+    void *map = mmap(NULL, cfv->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (map == MAP_FAILED)
+    {
+      cfv_close(cfv);
+
+      return false;
+    }
+
+    madvise(map, cfv->size, MADV_RANDOM);
+    cfv->map    = map;
+    cfv->mapped = cfv->size;
+  }
+
+  cfv->marks = cal_alloc(cfv->allocator, CFV_MARKS_INIT_CAP * sizeof(size_t));
+  cfv->chunk = cal_alloc(cfv->allocator, CFV_INDEX_CHUNK);
+
+  if (cfv->marks == NULL || cfv->chunk == NULL)
+  {
+    cfv_close(cfv);
+
+    return false;
+  }
+
+  // line 0 starts the file
+  cfv->marks[0]       = 0;
+  cfv->marks_size     = 1;
+  cfv->marks_capacity = CFV_MARKS_INIT_CAP;
+
+  return true;
+}
+
+size_t cfv_row(const cnc_file_view *cfv, size_t start, size_t width,
+               size_t *end)
+{
+  if (cfv == NULL || start >= cfv->size)
+  {
+    if (end != NULL)
+    {
+      *end = start;
+    }
+
+    return start;
+  }
+
+  // the next segment start ends the row at its first character, if the
+  // line is long
+  size_t segment = start / CFV_SEGMENT * CFV_SEGMENT;
+  size_t limit   = CFV_NONE;
+  size_t offset  = start;
+  size_t col     = 0;
+  size_t bytes   = 0;
+
+  if (segment == 0 || start >= _cfv_boundary(cfv, segment))
+  {
+    segment += CFV_SEGMENT;
+  }
+
+  while (offset < cfv->size && cfv->map[offset] != '\n')
+  {
+    if (offset >= segment)
+    {
+      limit   = _cfv_breaks(cfv, segment) ? _cfv_boundary(cfv, segment)
+                                          : CFV_NONE;
+      segment = CFV_NONE;
+    }
+
+    if (offset >= limit && offset > start)
+    {
+      break;
+    }
+
+    cnc_term_token token;
+    size_t         cells  = 0;
+    size_t         length = cfv_token(cfv, offset, col, &token, &cells);
+    size_t         drawn  = token.token.value == C_TAB ? cells
+                                                       : token.token.length;
+
+    // a row holds at least one character
+    if (offset > start && (col + cells > width ||
+                           bytes + drawn > width * CFV_CELL_BYTES))
+    {
+      break;
+    }
+
+    offset += length;
+    col += cells;
+    bytes += drawn;
+  }
+
+  if (end != NULL)
+  {
+    *end = offset;
+  }
+
+  // the line feed goes with the last row of its line
+  if (offset < cfv->size && cfv->map[offset] == '\n')
+  {
+    offset++;
+  }
+
+  return offset;
+}
+
+void cfv_set_width(cnc_file_view *cfv, size_t width, size_t *row)
+{
+  if (cfv == NULL || row == NULL)
+  {
+    return;
+  }
+
+  if (*row > cfv->size)
+  {
+    *row = cfv->size;
+  }
+
+  // rows start elsewhere at another width: the row holding the old start
+  if (cfv->width != width && *row < cfv->size)
+  {
+    *row = _cfv_row_of(cfv, *row, width);
+  }
+
+  cfv->width = width;
+}
+
+bool cfv_sync(cnc_file_view *cfv, size_t *row)
+{
+  if (cfv == NULL || row == NULL || cfv->fd < 0)
+  {
+    return false;
+  }
+
+  // a page of the map past the end of the file faults (SIGBUS): the size
+  // every read is bounded by follows the file. the file cut between this
+  // and the reads is caught by cfv_guard
+  struct stat st;
+
+  if (fstat(cfv->fd, &st) < 0 || (size_t)st.st_size == cfv->size)
+  {
+    return false;
+  }
+
+  size_t size = (size_t)st.st_size;
+
+  // longer than the map: mapped again, the old map stays on failure
+  if (size > cfv->mapped)
+  {
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, cfv->fd, 0);
+
+    if (map == MAP_FAILED)
+    {
+      return false;
+    }
+
+    madvise(map, size, MADV_RANDOM);
+
+    if (cfv->map != NULL)
+    {
+      munmap((void *)cfv->map, cfv->mapped);
+    }
+
+    cfv->map        = map;
+    cfv->mapped     = size;
+    cfv->kept_start = 0;
+    cfv->kept_end   = 0;
+  }
+
+  // cut short, rewritten from the start most likely: indexed again
+  if (size < cfv->size)
+  {
+    cfv->marks_size = 1;
+    cfv->indexed    = 0;
+    cfv->lines      = 0;
+
+    if (cfv->kept_end > size)
+    {
+      cfv->kept_end = size;
+    }
+
+    if (cfv->kept_start > size)
+    {
+      cfv->kept_start = size;
+    }
+  }
+
+  cfv->size = size;
+
+  // a row past the end moves to the last row
+  if (*row >= size)
+  {
+    *row = size > 0 ? _cfv_row_of(cfv, size - 1, cfv->width) : 0;
+  }
+
+  return true;
+}
+
+size_t cfv_token(const cnc_file_view *cfv, size_t offset, size_t col,
+                 cnc_term_token *token, size_t *width)
+{
+  // the map ends with the file: a character is parsed from a copy
+  uint8_t bytes[4] = {0};
+  size_t  left     = cfv->size - offset;
+  size_t  length   = left < sizeof(bytes) ? left : sizeof(bytes);
+
+  memcpy(bytes, cfv->map + offset, length);
+
+  // invalid UTF-8 and C1 controls are drawn as one replacement character
+  if (ctt_parse_bytes(bytes, token) == false ||
+      token->token.length > length ||
+      (token->token.type == CTT_UTF8 && token->token.value < 0xA0))
+  {
+    *token = ctt_parse_value(CFV_REPLACEMENT);
+    *width = 1;
+
+    return 1;
+  }
+
+  if (token->token.type == CTT_CHAR && token->token.value == C_TAB)
+  {
+    *width = CFV_TAB_WIDTH - col % CFV_TAB_WIDTH;
+
+    return 1;
+  }
+
+  // other controls (carriage returns, escapes) draw nothing
+  if (token->token.type == CTT_CHAR && token->token.width == W_NIL)
+  {
+    token->token.length = 0;
+    *width              = 0;
+
+    return 1;
+  }
+
+  *width = token->token.width;
+
+  return token->token.length;
+}
+
+void cfv_trim(cnc_file_view *cfv, size_t start, size_t end)
+{
+  if (cfv == NULL || cfv->map == NULL)
+  {
+    return;
+  }
+
+  // rows are wrapped from up to two segments back: those pages stay
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+  start = start > CFV_KEEP ? (start - CFV_KEEP) / page * page : 0;
+  end   = end + CFV_KEEP < cfv->size ? (end + CFV_KEEP) / page * page
+                                     : cfv->size;
+
+  if (start == cfv->kept_start && end == cfv->kept_end)
+  {
+    return;
+  }
+
+  // the pages stay in the page cache, only the process lets them go
+  if (start > 0)
+  {
+    madvise((void *)cfv->map, start, MADV_DONTNEED);
+  }
+
+  if (end < cfv->size)
+  {
+    madvise((void *)(cfv->map + end), cfv->size - end, MADV_DONTNEED);
+  }
+
+  cfv->kept_start = start;
+  cfv->kept_end   = end;
+}
+
+void cfv_usage(const cnc_file_view *cfv, cal_usage *usage)
+{
+  if (cfv == NULL || usage == NULL)
+  {
+    return;
+  }
+
+  // the mapped file is not counted: its pages belong to the page cache
+  size_t chunk = cfv->chunk != NULL ? CFV_INDEX_CHUNK : 0;
+
+  usage->used += cfv->marks_size * sizeof(*cfv->marks) + chunk;
+  usage->reserved += cfv->marks_capacity * sizeof(*cfv->marks) + chunk;
+}
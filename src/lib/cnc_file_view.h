@@ -0,0 +1,112 @@
+#ifndef CNC_FILE_VIEW_H
+#define CNC_FILE_VIEW_H
+
+// using cfv as shorthand for cnc_file_view
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cnc_allocator.h"
+#include "cnc_term_token.h"
+
+// lines between two marks of the line index
+#define CFV_INDEX_STEP 1024
+
+// bytes the index reads at once, and marks it starts with
+#define CFV_INDEX_CHUNK    (64 * 1024)
+#define CFV_MARKS_INIT_CAP 64
+
+// a line this long is wrapped from the last segment start (see below)
+#define CFV_SEGMENT (16 * 1024)
+
+// bytes kept mapped around the rows on screen by cfv_trim
+#define CFV_KEEP (2 * CFV_SEGMENT)
+
+// columns of a tab stop
+#define CFV_TAB_WIDTH 8
+
+// no line, or not indexed yet
+#define CFV_NONE ((size_t)-1)
+
+// read only view of a file mapped in memory: the text is never copied, a
+// row is decoded from the map when it is wrapped or drawn, so only the
+// pages on screen are touched. rows are found from a row start, moving up
+// searches back for the start of the line.
+//
+// a line longer than CFV_SEGMENT also starts a row at every segment start
+// (CFV_SEGMENT aligned offset) it crosses, so wrapping never walks more
+// than two segments, whatever the line length.
+//
+// line numbers come from a sparse index: the offset of every
+// CFV_INDEX_STEP-th line. it is filled a batch at a time (cfv_index) with
+// reads into a small chunk instead of the map, so indexing a huge file
+// does not make it resident. pages the view scrolled away from are handed
+// back (cfv_trim): the process keeps about what is on screen.
+//
+// the view follows the file, it is no snapshot: pages handed back are read
+// again from the file as it is then. cfv_sync measures the file before a
+// frame, a file cut short (logrotate copytruncate) is never read past its
+// new end and a longer one is mapped again. a file cut after that faults
+// the reads of the map (SIGBUS): cfv_guard runs them, and catches it.
+
+typedef struct
+{
+  int         fd;
+  const char *map;    // the whole file, NULL when closed or empty
+  size_t      mapped; // bytes of the map, the file may be shorter now
+  size_t      size;   // bytes of the file at the last cfv_sync
+  size_t      width; // wrap width of the anchor row (cfv_set_width)
+
+  // mapped bytes kept by the last cfv_trim, the others were handed back
+  size_t kept_start;
+  size_t kept_end;
+
+  // marks[i] is the offset of line i * CFV_INDEX_STEP
+  size_t *marks;
+  size_t  marks_size;
+  size_t  marks_capacity;
+
+  size_t indexed; // bytes scanned by the index
+  size_t lines;   // line feeds found in them
+  char  *chunk;   // CFV_INDEX_CHUNK bytes the index reads into
+
+  const cnc_allocator *allocator;
+
+} cnc_file_view;
+
+// main functions
+void cfv_close(cnc_file_view *cfv);
+bool cfv_guard(cnc_file_view *cfv, size_t *row, void (*read)(void *context),
+               void *context);
+bool cfv_index(cnc_file_view *cfv, size_t budget);
+void cfv_init(cnc_file_view *cfv, const cnc_allocator *allocator);
+
+size_t cfv_line(const cnc_file_view *cfv, size_t offset);
+size_t cfv_line_start(cnc_file_view *cfv, size_t line);
+
+void cfv_move(const cnc_file_view *cfv, size_t *row, ptrdiff_t delta,
+              size_t width);
+bool cfv_open(cnc_file_view *cfv, const char *path);
+
+size_t cfv_row(const cnc_file_view *cfv, size_t start, size_t width,
+               size_t *end);
+
+void cfv_set_width(cnc_file_view *cfv, size_t width, size_t *row);
+bool cfv_sync(cnc_file_view *cfv, size_t *row);
+void cfv_trim(cnc_file_view *cfv, size_t start, size_t end);
+
+size_t cfv_token(const cnc_file_view *cfv, size_t offset, size_t col,
+                 cnc_term_token *token, size_t *width);
+
+void cfv_usage(const cnc_file_view *cfv, cal_usage *usage);
+
+#endif
@@ -0,0 +1,439 @@
+#include "cnc_history.h"
+
+// private functions declaration
+static void   _ch_evict(cnc_history *ch);
+static size_t _ch_find(const cnc_history *ch, size_t below);
+static bool   _ch_store(cnc_history *ch, const char *text, size_t length);
+
+// private functions definition
+static void _ch_evict(cnc_history *ch)
+{
+  ch->first++;
+  ch->size--;
+}
+
+static size_t _ch_find(const cnc_history *ch, size_t below)
+{
+  // newest entry below number below holding the query
+  size_t end = ch->first + ch->size;
+
+  if (below > end)
+  {
+    below = end;
+  }
+
+  for (size_t number = below; number-- > ch->first;)
+  {
+    const ch_entry *entry = &ch->entries[number % ch->entries_capacity];
+
+    if (memmem(ch->bytes + entry->start, entry->length, ch->query,
+               ch->query_length) != NULL)
+    {
+      return number;
+    }
+  }
+
+  return CH_NONE;
+}
+
+static bool _ch_store(cnc_history *ch, const char *text, size_t length)
+{
+  size_t need  = length + 1;
+  size_t start = ch->write;
+
+  if (need > ch->bytes_capacity)
+  {
+    return false;
+  }
+
+  // entries never wrap: the ones left at the end of the ring go first
+  if (start + need > ch->bytes_capacity)
+  {
+    while (ch->size > 0 &&
+           ch->entries[ch->first % ch->entries_capacity].start >= start)
+    {
+      _ch_evict(ch);
+    }
+
+    start = 0;
+  }
+
+  // the oldest entries are the next bytes of the ring
+  while (ch->size > 0)
+  {
+    ch_entry *oldest = &ch->entries[ch->first % ch->entries_capacity];
+
+    if (ch->size < ch->entries_capacity &&
+        (oldest->start >= start + need ||
+         oldest->start + oldest->length + 1 <= start))
+    {
+      break;
+    }
+
+    _ch_evict(ch);
+  }
+
+  ch_entry *entry = &ch->entries[(ch->first + ch->size) % ch->entries_capacity];
+
+  entry->start  = start;
+  entry->length = length;
+
+  memcpy(ch->bytes + start, text, length);
+  ch->bytes[start + length] = '\0';
+
+  ch->write = start + need;
+  ch->size++;
+
+  return true;
+}
+
+// main functions
+bool ch_add(cnc_history *ch, const char *text, size_t length)
+{
+  if (ch == NULL || text == NULL)
+  {
+    return false;
+  }
+
+  // a new line is typed from the end of the history
+  ch_rewind(ch);
+
+  if (length == 0)
+  {
+    return false;
+  }
+
+  // a repeated line is kept once
+  if (ch->size > 0)
+  {
+    size_t      newest_length = 0;
+    const char *newest = ch_get(ch, ch->first + ch->size - 1, &newest_length);
+
+    if (newest_length == length && memcmp(newest, text, length) == 0)
+    {
+      return true;
+    }
+  }
+
+  if (_ch_store(ch, text, length) == false)
+  {
+    return false;
+  }
+
+  ch_rewind(ch);
+
+  if (ch->fd >= 0)
+  {
+    struct iovec line[2] = {
+      {(void *)text, length},
+      {"\n",         1     }
+    };
+
+    // one write per line: lines of several processes do not mix
+    if (writev(ch->fd, line, 2) < 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ch_destroy(cnc_history *ch)
+{
+  if (ch == NULL)
+  {
+    return;
+  }
+
+  if (ch->fd >= 0)
+  {
+    close(ch->fd);
+  }
+
+  cal_free(ch->allocator, ch->bytes);
+  cal_free(ch->allocator, ch->entries);
+
+  memset(ch, 0, sizeof(*ch));
+  ch->fd = -1;
+}
+
+const char *ch_get(const cnc_history *ch, size_t number, size_t *length)
+{
+  if (ch == NULL || number < ch->first || number >= ch->first + ch->size)
+  {
+    return NULL;
+  }
+
+  const ch_entry *entry = &ch->entries[number % ch->entries_capacity];
+
+  if (length != NULL)
+  {
+    *length = entry->length;
+  }
+
+  return ch->bytes + entry->start;
+}
+
+bool ch_init(cnc_history *ch, size_t bytes, size_t entries,
+             const cnc_allocator *allocator)
+{
+  if (ch == NULL)
+  {
+    return false;
+  }
+
+  memset(ch, 0, sizeof(*ch));
+
+  ch->allocator        = allocator;
+  ch->fd               = -1;
+  ch->bytes_capacity   = bytes > 0 ? bytes : CH_BYTES_DEFAULT;
+  ch->entries_capacity = entries > 0 ? entries : CH_ENTRIES_DEFAULT;
+
+  // all the memory the history will use, taken once
+  ch->bytes = cal_alloc(allocator, ch->bytes_capacity);
+  ch->entries =
+    cal_alloc(allocator, ch->entries_capacity * sizeof(*ch->entries));
+
+  if (ch->bytes == NULL || ch->entries == NULL)
+  {
+    ch_destroy(ch);
+
+    return false;
+  }
+
+  ch_search_begin(ch);
+
+  return true;
+}
+
+bool ch_load(cnc_history *ch, const char *path)
+{
+  if (ch == NULL || path == NULL)
+  {
+    return false;
+  }
+
+  int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0600);
+
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st;
+
+  if (fstat(fd, &st) < 0)
+  {
+    close(fd);
+
+    return false;
+  }
+
+  size_t size = (size_t)st.st_size;
+
+  if (size > 0)
+  {
+    char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (map == MAP_FAILED)
+    {
+      close(fd);
+
+      return false;
+    }
+
+    // only the lines that fit are read: the pages before them are never
+    // touched, however long the file grew
+    size_t start = size;
+    size_t lines = 0;
+
+    while (start > 0 && lines <= ch->entries_capacity &&
+           size - start < ch->bytes_capacity)
+    {
+      start--;
+
+      if (map[start] == '\n')
+      {
+        lines++;
+      }
+    }
+
+    // a line cut by the byte limit is left out
+    if (start > 0 && map[start - 1] != '\n')
+    {
+      char *end = memchr(map + start, '\n', size - start);
+      start     = end != NULL ? (size_t)(end - map) : size;
+    }
+
+    while (start < size)
+    {
+      char  *end    = memchr(map + start, '\n', size - start);
+      size_t length = end != NULL ? (size_t)(end - map) - start
+                                  : size - start;
+
+      if (length > 0)
+      {
+        _ch_store(ch, map + start, length);
+      }
+
+      start += length + 1;
+    }
+
+    munmap(map, size);
+  }
+
+  if (ch->fd >= 0)
+  {
+    close(ch->fd);
+  }
+
+  // lines added from now on go to the file too
+  ch->fd = fd;
+
+  ch_rewind(ch);
+
+  return true;
+}
+
+const char *ch_next(cnc_history *ch, size_t *length)
+{
+  if (ch == NULL || ch->browse >= ch->first + ch->size)
+  {
+    return NULL;
+  }
+
+  // NULL past the newest entry: back on the typed line
+  ch->browse++;
+
+  return ch_get(ch, ch->browse, length);
+}
+
+const char *ch_prev(cnc_history *ch, size_t *length)
+{
+  if (ch == NULL || ch->browse <= ch->first)
+  {
+    return NULL;
+  }
+
+  ch->browse--;
+
+  return ch_get(ch, ch->browse, length);
+}
+
+void ch_rewind(cnc_history *ch)
+{
+  if (ch == NULL)
+  {
+    return;
+  }
+
+  ch->browse = ch->first + ch->size;
+}
+
+size_t ch_search_begin(cnc_history *ch)
+{
+  if (ch == NULL)
+  {
+    return CH_NONE;
+  }
+
+  // the empty query shows the typed line
+  ch->query_length = 0;
+  ch->matches[0]   = CH_NONE;
+
+  return CH_NONE;
+}
+
+size_t ch_search_older(cnc_history *ch)
+{
+  if (ch == NULL)
+  {
+    return CH_NONE;
+  }
+
+  size_t match = ch->matches[ch->query_length];
+
+  if (ch->query_length == 0 || match == CH_NONE)
+  {
+    return match;
+  }
+
+  // the oldest match stays when there is none older
+  size_t older = _ch_find(ch, match);
+
+  if (older != CH_NONE)
+  {
+    ch->matches[ch->query_length] = older;
+  }
+
+  return ch->matches[ch->query_length];
+}
+
+size_t ch_search_pop(cnc_history *ch)
+{
+  if (ch == NULL || ch->query_length == 0)
+  {
+    return CH_NONE;
+  }
+
+  // a whole UTF-8 character
+  do
+  {
+    ch->query_length--;
+
+  } while (ch->query_length > 0 &&
+           (ch->query[ch->query_length] & 0xC0) == 0x80);
+
+  return ch->matches[ch->query_length];
+}
+
+size_t ch_search_push(cnc_history *ch, const char *bytes, size_t length)
+{
+  if (ch == NULL || bytes == NULL)
+  {
+    return CH_NONE;
+  }
+
+  size_t match = ch->matches[ch->query_length];
+
+  if (length == 0 || ch->query_length + length > CH_QUERY_SIZE)
+  {
+    return match;
+  }
+
+  // entries newer than the match do not hold the shorter query, nor the
+  // longer one: the search goes on from the match
+  size_t below = ch->query_length == 0 ? ch->first + ch->size : match + 1;
+  bool   found = ch->query_length == 0 || match != CH_NONE;
+
+  memcpy(ch->query + ch->query_length, bytes, length);
+  ch->query_length += length;
+
+  match = found ? _ch_find(ch, below) : CH_NONE;
+
+  // every byte of a character gets the match
+  for (size_t i = 0; i < length; i++)
+  {
+    ch->matches[ch->query_length - i] = match;
+  }
+
+  return match;
+}
+
+void ch_usage(const cnc_history *ch, cal_usage *usage)
+{
+  if (ch == NULL || usage == NULL)
+  {
+    return;
+  }
+
+  for (size_t number = ch->first; number < ch->first + ch->size; number++)
+  {
+    usage->used += ch->entries[number % ch->entries_capacity].length + 1;
+  }
+
+  usage->used += ch->size * sizeof(*ch->entries);
+  usage->reserved +=
+    ch->bytes_capacity + ch->entries_capacity * sizeof(*ch->entries);
+}
@@ -0,0 +1,94 @@
+#ifndef CNC_HISTORY_H
+#define CNC_HISTORY_H
+
+// using ch as shorthand for cnc_history
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "cnc_allocator.h"
+
+// default text bytes and entries of a history (ch_init with 0)
+#define CH_BYTES_DEFAULT   (64 * 1024)
+#define CH_ENTRIES_DEFAULT 1024
+
+// bytes of a reverse search query
+#define CH_QUERY_SIZE 64
+
+// no entry: nothing matches, or the line being typed
+#define CH_NONE ((size_t)-1)
+
+// prompt history in fixed memory: the text of the entries is kept in a
+// byte ring (an entry never wraps around its end) and the entries in a
+// ring of their own. adding a line evicts the oldest entries it needs
+// room from. entries are numbered from the first line ever kept, so
+// numbers stay valid while they are not evicted.
+//
+// reverse search is incremental: the newest match of every query prefix
+// is kept, a longer query only looks from the current match back, and a
+// shorter one takes its match back from the stack.
+
+typedef struct
+{
+  size_t start;  // first byte in the byte ring
+  size_t length; // bytes, '\0' excluded
+
+} ch_entry;
+
+typedef struct
+{
+  // text of the entries, each followed by '\0'
+  char  *bytes;
+  size_t bytes_capacity;
+  size_t write; // where the next entry starts
+
+  // entries first to first + size - 1, oldest first
+  ch_entry *entries;
+  size_t    entries_capacity;
+  size_t    first;
+  size_t    size;
+
+  // entry shown by ch_prev and ch_next, first + size on the typed line
+  size_t browse;
+
+  // reverse search query, and the match of each of its prefixes
+  char   query[CH_QUERY_SIZE];
+  size_t query_length;
+  size_t matches[CH_QUERY_SIZE + 1];
+
+  // file the lines are appended to (ch_load), -1 for none
+  int fd;
+
+  const cnc_allocator *allocator;
+
+} cnc_history;
+
+// main functions
+bool ch_add(cnc_history *ch, const char *text, size_t length);
+void ch_destroy(cnc_history *ch);
+
+const char *ch_get(const cnc_history *ch, size_t number, size_t *length);
+
+bool ch_init(cnc_history *ch, size_t bytes, size_t entries,
+             const cnc_allocator *allocator);
+bool ch_load(cnc_history *ch, const char *path);
+
+const char *ch_next(cnc_history *ch, size_t *length);
+const char *ch_prev(cnc_history *ch, size_t *length);
+
+void   ch_rewind(cnc_history *ch);
+size_t ch_search_begin(cnc_history *ch);
+size_t ch_search_older(cnc_history *ch);
+size_t ch_search_pop(cnc_history *ch);
+size_t ch_search_push(cnc_history *ch, const char *bytes, size_t length);
+void   ch_usage(const cnc_history *ch, cal_usage *usage);
+
+#endif
@@ -0,0 +1,270 @@
+#include "cnc_layout.h"
+
+// marks a ratio child not sized yet by _cl_share
+#define CL_PENDING ((size_t)-1)
+
+// private functions declaration
+static cnc_layout *_cl_create(cl_type type, const cnc_allocator *allocator);
+static bool        _cl_share(cnc_layout *cl, size_t length, size_t *sizes);
+
+// private functions definition
+static cnc_layout *_cl_create(cl_type type, const cnc_allocator *allocator)
+{
+  cnc_layout *cl = cal_alloc(allocator, sizeof(*cl));
+
+  if (cl == NULL)
+  {
+    return NULL;
+  }
+
+  memset(cl, 0, sizeof(*cl));
+
+  cl->type      = type;
+  cl->size      = CL_SIZE_RATIO;
+  cl->value     = 1;
+  cl->allocator = allocator;
+
+  return cl;
+}
+
+static bool _cl_share(cnc_layout *cl, size_t length, size_t *sizes)
+{
+  /*
+   * fixed children take their cells first, ratio children share the rest
+   * by weight. a ratio child whose share is below its min gets its min and
+   * leaves the sharing, until every share fits. rounding leftovers go to
+   * the last ratio child, or to the last child when none is a ratio.
+   */
+
+  size_t rest    = length;
+  size_t weights = 0;
+
+  for (size_t i = 0; i < cl->children_size; i++)
+  {
+    cnc_layout *child = cl->children[i];
+
+    if (child->size == CL_SIZE_FIXED)
+    {
+      sizes[i] = child->value > child->min ? child->value : child->min;
+
+      if (sizes[i] > rest)
+      {
+        return false;
+      }
+
+      rest -= sizes[i];
+    }
+
+    else
+    {
+      sizes[i] = CL_PENDING;
+      weights += child->value;
+    }
+  }
+
+  bool clamped = true;
+
+  while (clamped)
+  {
+    clamped = false;
+
+    for (size_t i = 0; i < cl->children_size; i++)
+    {
+      cnc_layout *child = cl->children[i];
+      size_t share = weights > 0 ? rest * child->value / weights : 0;
+
+      if (sizes[i] != CL_PENDING || share >= child->min)
+      {
+        continue;
+      }
+
+      if (child->min > rest)
+      {
+        return false;
+      }
+
+      sizes[i] = child->min;
+      rest -= child->min;
+      weights -= child->value;
+      clamped = true;
+    }
+  }
+
+  size_t left = rest;
+  size_t last = cl->children_size - 1;
+
+  for (size_t i = 0; i < cl->children_size; i++)
+  {
+    if (sizes[i] == CL_PENDING)
+    {
+      sizes[i] = weights > 0 ? rest * cl->children[i]->value / weights : 0;
+      left -= sizes[i];
+      last = i;
+    }
+  }
+
+  sizes[last] += left;
+
+  return true;
+}
+
+// main functions
+bool cl_add(cnc_layout *split, cnc_layout *child)
+{
+  if (split == NULL || child == NULL || split->type == CL_LEAF)
+  {
+    return false;
+  }
+
+  if (split->children_size >= split->children_capacity)
+  {
+    size_t new_capacity = split->children_capacity == 0
+                            ? CL_CHILDREN_INIT_CAP
+                            : split->children_capacity * 2;
+
+    cnc_layout **new_children =
+      cal_realloc(split->allocator, split->children,
+                  new_capacity * sizeof(*new_children));
+
+    if (new_children == NULL)
+    {
+      return false;
+    }
+
+    split->children          = new_children;
+    split->children_capacity = new_capacity;
+  }
+
+  // title, info and prompt are two rows high: fixed when stacked, as wide
+  // as their share side by side
+  cnc_widget *cw = child->widget;
+
+  if (split->type == CL_SPLIT_V && child->sized == false && cw != NULL &&
+      cw->type != WIDGET_DISPLAY && cw->type != WIDGET_FILE)
+  {
+    child->size  = CL_SIZE_FIXED;
+    child->value = 2;
+    child->min   = 2;
+  }
+
+  // the split owns its children from now on
+  split->children[split->children_size++] = child;
+
+  return true;
+}
+
+bool cl_compute(cnc_layout *cl, cnc_rect frame)
+{
+  if (cl == NULL)
+  {
+    return false;
+  }
+
+  cl->frame = frame;
+
+  if (cl->type == CL_LEAF)
+  {
+    if (cl->widget != NULL)
+    {
+      cl->widget->frame = frame;
+    }
+
+    return true;
+  }
+
+  if (cl->children_size == 0)
+  {
+    return true;
+  }
+
+  size_t *sizes =
+    cal_alloc(cl->allocator, cl->children_size * sizeof(*sizes));
+
+  if (sizes == NULL)
+  {
+    return false;
+  }
+
+  bool   horizontal = cl->type == CL_SPLIT_H;
+  size_t length     = horizontal ? frame.width : frame.height;
+  bool   result     = _cl_share(cl, length, sizes);
+  size_t offset     = 0;
+
+  for (size_t i = 0; result && i < cl->children_size; i++)
+  {
+    cnc_rect child = frame;
+
+    if (horizontal)
+    {
+      child.origin.col += offset;
+      child.width = sizes[i];
+    }
+
+    else
+    {
+      child.origin.row += offset;
+      child.height = sizes[i];
+    }
+
+    offset += sizes[i];
+    result = cl_compute(cl->children[i], child);
+  }
+
+  cal_free(cl->allocator, sizes);
+
+  return result;
+}
+
+void cl_destroy(cnc_layout *cl)
+{
+  if (cl == NULL)
+  {
+    return;
+  }
+
+  // widgets belong to the terminal, only the tree is freed
+  for (size_t i = 0; i < cl->children_size; i++)
+  {
+    cl_destroy(cl->children[i]);
+  }
+
+  cal_free(cl->allocator, cl->children);
+  cal_free(cl->allocator, cl);
+}
+
+cnc_layout *cl_leaf(cnc_widget *cw, const cnc_allocator *allocator)
+{
+  cnc_layout *cl = _cl_create(CL_LEAF, allocator);
+
+  if (cl == NULL)
+  {
+    return NULL;
+  }
+
+  cl->widget = cw;
+
+  return cl;
+}
+
+void cl_set_size(cnc_layout *cl, cl_size size, size_t value, size_t min)
+{
+  if (cl == NULL)
+  {
+    return;
+  }
+
+  cl->size  = size;
+  cl->value = value;
+  cl->min   = min;
+  cl->sized = true;
+}
+
+cnc_layout *cl_split(cl_type type, const cnc_allocator *allocator)
+{
+  if (type == CL_LEAF)
+  {
+    return NULL;
+  }
+
+  return _cl_create(type, allocator);
+}
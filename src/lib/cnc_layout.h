@@ -0,0 +1,73 @@
+#ifndef CNC_LAYOUT_H
+#define CNC_LAYOUT_H
+
+// using cl as shorthand for cnc_layout
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cnc_allocator.h"
+#include "cnc_widget.h"
+
+// split children table initial capacity
+#define CL_CHILDREN_INIT_CAP 4
+
+// split tree: a split shares its frame between its children, side by side
+// (CL_SPLIT_H) or stacked (CL_SPLIT_V), a leaf gives its frame to a
+// widget. along the split, a child is fixed (value cells) or takes a
+// ratio (value is its weight) of what fixed children leave, never less
+// than min cells. cl_compute sets every widget frame, once per resize.
+
+typedef enum
+{
+  CL_LEAF,
+  CL_SPLIT_H, // children side by side, splitting the columns
+  CL_SPLIT_V, // children stacked, splitting the rows
+
+} cl_type;
+
+typedef enum
+{
+  CL_SIZE_RATIO,
+  CL_SIZE_FIXED,
+
+} cl_size;
+
+typedef struct cnc_layout
+{
+  cl_type  type;
+  cnc_rect frame;
+
+  // size along the split of the parent. sized: set by cl_set_size, a
+  // default (cl_add) does not replace it
+  cl_size size;
+  size_t  value;
+  size_t  min;
+  bool    sized;
+
+  // leaf
+  cnc_widget *widget;
+
+  // split
+  struct cnc_layout **children;
+  size_t              children_size;
+  size_t              children_capacity;
+
+  const cnc_allocator *allocator;
+
+} cnc_layout;
+
+// main functions
+bool cl_add(cnc_layout *split, cnc_layout *child);
+bool cl_compute(cnc_layout *cl, cnc_rect frame);
+void cl_destroy(cnc_layout *cl);
+
+cnc_layout *cl_leaf(cnc_widget *cw, const cnc_allocator *allocator);
+
+void cl_set_size(cnc_layout *cl, cl_size size, size_t value, size_t min);
+
+cnc_layout *cl_split(cl_type type, const cnc_allocator *allocator);
+
+#endif
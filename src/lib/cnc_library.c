@@ -11,12 +11,14 @@ static void _ca_refresh_info(cnc_app *ca)
 
   cnc_buffer b;
 
-  if (cb_init(&b, INFO_BUFFER_SIZE) == false)
+  if (cb_init_with_allocator(&b, ca->cw_info_bar->buffer.max_capacity,
+                             &ca->cterm->allocator) == false)
   {
     return;
   }
 
-  for (size_t i = 23; i < ca->cw_info_bar->buffer.size; i++)
+  // the text after the prefix written by ca_set_info
+  for (size_t i = ca->info_prefix; i < ca->cw_info_bar->buffer.size; i++)
   {
     cb_push(&b, ca->cw_info_bar->buffer.data[i]);
   }
@@ -49,6 +51,24 @@ int ca_get_user_input(cnc_app *ca)
 }
 
 bool ca_init(cnc_app *ca, uint32_t min_term_rows, uint32_t min_term_cols)
+{
+  return ca_init_with_allocator(ca, min_term_rows, min_term_cols, NULL);
+}
+
+bool ca_init_with_allocator(cnc_app *ca, uint32_t min_term_rows,
+                            uint32_t             min_term_cols,
+                            const cnc_allocator *allocator)
+{
+  cnc_backend tty = cbe_tty();
+
+  return ca_init_with_backend(ca, min_term_rows, min_term_cols, allocator,
+                              &tty);
+}
+
+bool ca_init_with_backend(cnc_app *ca, uint32_t min_term_rows,
+                          uint32_t             min_term_cols,
+                          const cnc_allocator *allocator,
+                          const cnc_backend   *backend)
 {
   if (ca == NULL)
   {
@@ -60,7 +80,15 @@ bool ca_init(cnc_app *ca, uint32_t min_term_rows, uint32_t min_term_cols)
   ca->min_term_rows = min_term_rows;
   ca->min_term_cols = min_term_cols;
 
-  ca->cterm = ct_init(min_term_rows, min_term_cols);
+  // widgets are added by ca_setup
+  ca->cw_title_bar = NULL;
+  ca->cw_display   = NULL;
+  ca->cw_info_bar  = NULL;
+  ca->cw_prompt    = NULL;
+  ca->info_prefix  = 0;
+
+  ca->cterm =
+    ct_init_with_backend(min_term_rows, min_term_cols, allocator, backend);
 
   if (ca->cterm == NULL)
   {
@@ -73,6 +101,28 @@ bool ca_init(cnc_app *ca, uint32_t min_term_rows, uint32_t min_term_cols)
   return true;
 }
 
+bool ca_set_capacity(cnc_app *ca, cw_type type, size_t capacity)
+{
+  if (ca == NULL)
+  {
+    return false;
+  }
+
+  cnc_widget *widgets[] = {ca->cw_title_bar, ca->cw_display, ca->cw_info_bar,
+                           ca->cw_prompt};
+
+  // the app has one widget of each type (ca_setup)
+  for (size_t i = 0; i < sizeof(widgets) / sizeof(*widgets); i++)
+  {
+    if (widgets[i] != NULL && widgets[i]->type == type)
+    {
+      return cw_set_capacity(widgets[i], capacity);
+    }
+  }
+
+  return false;
+}
+
 void ca_set_info(cnc_app *ca, const char *text)
 {
   if (ca == NULL || text == NULL)
@@ -80,10 +130,10 @@ void ca_set_info(cnc_app *ca, const char *text)
     return;
   }
 
-  char buf[14];
+  char buf[48];
 
-  sprintf(buf, "[%5zu/%5zu]", ca->cw_display->buffer.size,
-          ca->cw_display->buffer.capacity);
+  snprintf(buf, sizeof(buf), "[%5zu/%5zu]", ca->cw_display->buffer.size,
+           ca->cw_display->buffer.capacity);
 
   cb_set_txt(&ca->cw_info_bar->buffer, buf);
 
@@ -102,6 +152,8 @@ void ca_set_info(cnc_app *ca, const char *text)
     cb_append_txt(&ca->cw_info_bar->buffer, "          ");
   }
 
+  ca->info_prefix = ca->cw_info_bar->buffer.size;
+
   cb_append_txt(&ca->cw_info_bar->buffer, text);
 }
 
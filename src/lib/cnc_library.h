@@ -3,8 +3,11 @@
 
 // ca -> cnc_app
 
+#include "cnc_allocator.h"
+#include "cnc_backend.h"
 #include "cnc_buffer.h"
 #include "cnc_cursor.h"
+#include "cnc_style.h"
 #include "cnc_term_token.h"
 #include "cnc_term_token_width.h"
 #include "cnc_terminal.h"
@@ -22,11 +25,22 @@ typedef struct
 
   cnc_terminal *cterm;
 
+  // tokens of the info bar before the text of ca_set_info
+  size_t info_prefix;
+
 } cnc_app;
 
 void ca_destroy(cnc_app *ca);
 int  ca_get_user_input(cnc_app *ca);
 bool ca_init(cnc_app *ca, uint32_t min_term_rows, uint32_t min_term_cols);
+bool ca_init_with_allocator(cnc_app *ca, uint32_t min_term_rows,
+                            uint32_t             min_term_cols,
+                            const cnc_allocator *allocator);
+bool ca_init_with_backend(cnc_app *ca, uint32_t min_term_rows,
+                          uint32_t             min_term_cols,
+                          const cnc_allocator *allocator,
+                          const cnc_backend   *backend);
+bool ca_set_capacity(cnc_app *ca, cw_type type, size_t capacity);
 void ca_set_info(cnc_app *ca, const char *text);
 bool ca_setup(cnc_app *ca, char *version, char *title, char *welcome_message,
               char *info_bar_text);
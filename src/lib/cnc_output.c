@@ -0,0 +1,214 @@
+#include "cnc_output.h"
+
+// private functions declaration
+static void _co_finish(cnc_output *co);
+static bool _co_store(cnc_output *co, co_frame *frame, const char *bytes,
+                      size_t size);
+
+// private functions definition
+static void _co_finish(cnc_output *co)
+{
+  // current is done (or failed): the waiting frame takes its place
+  if (co->has_next)
+  {
+    co_frame frame = co->current;
+    co->current    = co->next;
+    co->next       = frame;
+    co->next.size  = 0;
+    co->has_next   = false;
+  }
+
+  else
+  {
+    co->current.size = 0;
+  }
+
+  co->offset = 0;
+}
+
+static bool _co_store(cnc_output *co, co_frame *frame, const char *bytes,
+                      size_t size)
+{
+  if (frame->capacity < size)
+  {
+    char *new_bytes = cal_realloc(co->allocator, frame->bytes, size);
+
+    if (new_bytes == NULL)
+    {
+      return false;
+    }
+
+    frame->bytes    = new_bytes;
+    frame->capacity = size;
+  }
+
+  memcpy(frame->bytes, bytes, size);
+  frame->size = size;
+
+  return true;
+}
+
+// main functions
+void co_destroy(cnc_output *co)
+{
+  if (co == NULL)
+  {
+    return;
+  }
+
+  cal_free(co->allocator, co->current.bytes);
+  cal_free(co->allocator, co->next.bytes);
+
+  memset(&co->current, 0, sizeof(co->current));
+  memset(&co->next, 0, sizeof(co->next));
+
+  co->offset   = 0;
+  co->has_next = false;
+}
+
+bool co_drain(cnc_output *co)
+{
+  if (co == NULL)
+  {
+    return false;
+  }
+
+  // blocks until every pending byte is written or a write fails
+  while (co_flush(co) == false)
+  {
+    if (co_wait(co, -1) == false)
+    {
+      return false;
+    }
+  }
+
+  return co->error == 0;
+}
+
+bool co_flush(cnc_output *co)
+{
+  if (co == NULL)
+  {
+    return true;
+  }
+
+  while (co_pending(co))
+  {
+    ssize_t count =
+      co->backend->write(co->backend->context, co->current.bytes + co->offset,
+                         co->current.size - co->offset);
+
+    co->syscalls++;
+
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      // the terminal is full: the rest goes out on a later flush
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        return false;
+      }
+
+      // the terminal is gone or broken: nothing left is worth writing
+      co->error    = errno;
+      co->has_next = false;
+      _co_finish(co);
+
+      return true;
+    }
+
+    co->offset += (size_t)count;
+
+    if (co->offset == co->current.size)
+    {
+      co->written++;
+      _co_finish(co);
+    }
+  }
+
+  return true;
+}
+
+bool co_init(cnc_output *co, const cnc_allocator *allocator,
+             const cnc_backend *backend)
+{
+  if (co == NULL || backend == NULL)
+  {
+    return false;
+  }
+
+  memset(co, 0, sizeof(*co));
+
+  co->allocator = allocator == NULL ? cal_default() : allocator;
+  co->backend   = backend;
+
+  return true;
+}
+
+bool co_pending(const cnc_output *co)
+{
+  return co != NULL && (co->current.size > 0 || co->has_next);
+}
+
+bool co_submit(cnc_output *co, const char *bytes, size_t size)
+{
+  if (co == NULL || (bytes == NULL && size > 0))
+  {
+    return false;
+  }
+
+  if (size == 0)
+  {
+    return true;
+  }
+
+  // a frame not started yet is replaced, a started one must finish first
+  bool      started = co->offset > 0;
+  co_frame *frame   = started ? &co->next : &co->current;
+  bool      waiting = started ? co->has_next : co->current.size > 0;
+
+  if (_co_store(co, frame, bytes, size) == false)
+  {
+    return false;
+  }
+
+  if (waiting)
+  {
+    co->dropped++;
+  }
+
+  if (started)
+  {
+    co->has_next = true;
+  }
+
+  return true;
+}
+
+void co_usage(const cnc_output *co, cal_usage *usage)
+{
+  if (co == NULL || usage == NULL)
+  {
+    return;
+  }
+
+  usage->used += co->current.size + (co->has_next ? co->next.size : 0);
+  usage->reserved += co->current.capacity + co->next.capacity;
+}
+
+bool co_wait(cnc_output *co, int timeout_ms)
+{
+  if (co == NULL)
+  {
+    return false;
+  }
+
+  // false on errors only, a timeout is left to the caller's next flush
+  co->syscalls++;
+
+  return co->backend->wait(co->backend->context, timeout_ms);
+}
@@ -0,0 +1,58 @@
+#ifndef CNC_OUTPUT_H
+#define CNC_OUTPUT_H
+
+// using co as shorthand for cnc_output
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cnc_allocator.h"
+#include "cnc_backend.h"
+
+// frame writer for a non-blocking backend: co_flush writes what the
+// terminal accepts and returns, the rest stays pending. a frame started on
+// the terminal is always finished (a cut escape sequence would garble the
+// next one), frames waiting behind it are replaced by newer ones: a slow
+// terminal skips to the latest frame instead of replaying stale ones.
+
+typedef struct
+{
+  char  *bytes;
+  size_t size;
+  size_t capacity;
+
+} co_frame;
+
+typedef struct
+{
+  const cnc_allocator *allocator;
+  const cnc_backend   *backend;
+
+  co_frame current; // frame on its way to the terminal
+  size_t   offset;  // bytes of current already written
+  co_frame next;    // newest frame waiting for current
+  bool     has_next;
+
+  size_t written;  // frames fully written
+  size_t syscalls; // backend writes and waits
+  size_t dropped;  // frames replaced before their first byte was written
+  int    error;    // errno of the last failed write, 0 if none
+
+} cnc_output;
+
+// main functions
+void co_destroy(cnc_output *co);
+bool co_drain(cnc_output *co);
+bool co_flush(cnc_output *co);
+bool co_init(cnc_output *co, const cnc_allocator *allocator,
+             const cnc_backend *backend);
+bool co_pending(const cnc_output *co);
+bool co_submit(cnc_output *co, const char *bytes, size_t size);
+void co_usage(const cnc_output *co, cal_usage *usage);
+bool co_wait(cnc_output *co, int timeout_ms);
+
+#endif
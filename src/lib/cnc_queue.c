@@ -0,0 +1,139 @@
+#include "cnc_queue.h"
+
+// private functions declaration
+static void _cq_link(cnc_queue *cq, cq_node *node);
+
+// private functions definition
+static void _cq_link(cnc_queue *cq, cq_node *node)
+{
+  __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+
+  // claim the head, then publish the node to the previous one
+  cq_node *prev = __atomic_exchange_n(&cq->head, node, __ATOMIC_ACQ_REL);
+  __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+// main functions
+const char *cq_bytes(const cq_node *node)
+{
+  // messages are stored right after their node, '\0' terminated
+  return (const char *)(node + 1);
+}
+
+void cq_destroy(cnc_queue *cq)
+{
+  if (cq == NULL)
+  {
+    return;
+  }
+
+  // producers must be done: free what was never popped
+  cq_node *node;
+
+  while ((node = cq_pop(cq)) != NULL)
+  {
+    cq_free(node);
+  }
+}
+
+void cq_free(cq_node *node)
+{
+  // nodes are shared between threads: always the default allocator
+  cal_free(cal_default(), node);
+}
+
+bool cq_init(cnc_queue *cq)
+{
+  if (cq == NULL)
+  {
+    return false;
+  }
+
+  cq->stub.next   = NULL;
+  cq->stub.length = 0;
+  cq->head        = &cq->stub;
+  cq->tail        = &cq->stub;
+
+  return true;
+}
+
+cq_node *cq_pop(cnc_queue *cq)
+{
+  if (cq == NULL)
+  {
+    return NULL;
+  }
+
+  cq_node *tail = cq->tail;
+  cq_node *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+  // skip the stub, it only keeps the list non empty
+  if (tail == &cq->stub)
+  {
+    if (next == NULL)
+    {
+      return NULL;
+    }
+
+    cq->tail = next;
+    tail     = next;
+    next     = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+  }
+
+  if (next != NULL)
+  {
+    cq->tail = next;
+
+    return tail;
+  }
+
+  // tail looks last: a producer may be between its exchange and its link
+  if (tail != __atomic_load_n(&cq->head, __ATOMIC_ACQUIRE))
+  {
+    return NULL;
+  }
+
+  // put the stub back behind the last node, so it can be handed out
+  _cq_link(cq, &cq->stub);
+
+  next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+  if (next != NULL)
+  {
+    cq->tail = next;
+
+    return tail;
+  }
+
+  return NULL;
+}
+
+bool cq_push(cnc_queue *cq, const char *bytes, size_t length)
+{
+  if (cq == NULL || (bytes == NULL && length > 0))
+  {
+    return false;
+  }
+
+  cq_node *node = cal_alloc(cal_default(), sizeof(*node) + length + 1);
+
+  if (node == NULL)
+  {
+    return false;
+  }
+
+  node->length = length;
+
+  char *data = (char *)(node + 1);
+
+  if (length > 0)
+  {
+    memcpy(data, bytes, length);
+  }
+
+  data[length] = '\0';
+
+  _cq_link(cq, node);
+
+  return true;
+}
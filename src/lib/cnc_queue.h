@@ -0,0 +1,43 @@
+#ifndef CNC_QUEUE_H
+#define CNC_QUEUE_H
+
+// using cq as shorthand for cnc_queue
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cnc_allocator.h"
+
+// multi-producer single-consumer queue of byte messages (D. Vyukov's
+// intrusive MPSC queue): producers on any thread push with one atomic
+// exchange and never wait, the consumer pops without atomics read-modify-
+// writes. a node just pushed may stay hidden from the consumer until its
+// producer links it: cq_pop then returns NULL and the node shows up later.
+
+typedef struct cq_node
+{
+  struct cq_node *next;
+  size_t          length; // bytes following the node, '\0' excluded
+
+} cq_node;
+
+typedef struct
+{
+  cq_node *head; // last pushed node, shared by producers
+  cq_node *tail; // next node to pop, consumer only
+  cq_node  stub;
+
+} cnc_queue;
+
+// main functions
+const char *cq_bytes(const cq_node *node);
+void        cq_destroy(cnc_queue *cq);
+void        cq_free(cq_node *node);
+bool        cq_init(cnc_queue *cq);
+cq_node    *cq_pop(cnc_queue *cq);
+bool        cq_push(cnc_queue *cq, const char *bytes, size_t length);
+
+#endif
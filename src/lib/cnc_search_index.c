@@ -0,0 +1,343 @@
+#include "cnc_search_index.h"
+
+// private functions declaration
+static bool   _csi_add(const cnc_allocator *allocator, csi_postings *pl,
+                       size_t position);
+static size_t _csi_hash(const cnc_search_index *csi,
+                        const cnc_term_token *gram);
+static size_t _csi_lower_bound(const csi_postings *pl, size_t position);
+static void   _csi_prune(cnc_search_index *csi, size_t base);
+
+// private functions definition
+static bool _csi_add(const cnc_allocator *allocator, csi_postings *pl,
+                     size_t position)
+{
+  if (pl->size >= pl->capacity)
+  {
+    size_t new_capacity =
+      pl->capacity == 0 ? CSI_POSTINGS_INIT_CAP : pl->capacity * 2;
+
+    size_t *new_positions = cal_realloc(allocator, pl->positions,
+                                        new_capacity * sizeof(*new_positions));
+
+    if (new_positions == NULL)
+    {
+      return false;
+    }
+
+    pl->positions = new_positions;
+    pl->capacity  = new_capacity;
+  }
+
+  pl->positions[pl->size++] = position;
+
+  return true;
+}
+
+static size_t _csi_hash(const cnc_search_index *csi,
+                        const cnc_term_token *gram)
+{
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < CSI_GRAM_SIZE; i++)
+  {
+    hash = (hash ^ gram[i].token.value) * 16777619u;
+  }
+
+  return (hash ^ (hash >> 16)) & (csi->buckets_size - 1);
+}
+
+static size_t _csi_lower_bound(const csi_postings *pl, size_t position)
+{
+  size_t lo = 0;
+  size_t hi = pl->size;
+
+  while (lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+
+    if (pl->positions[mid] < position)
+    {
+      lo = mid + 1;
+    }
+
+    else
+    {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+static void _csi_prune(cnc_search_index *csi, size_t base)
+{
+  for (size_t i = 0; i < csi->buckets_size; i++)
+  {
+    csi_postings *pl    = &csi->buckets[i];
+    size_t        first = _csi_lower_bound(pl, base);
+
+    if (first > 0)
+    {
+      memmove(pl->positions, pl->positions + first,
+              (pl->size - first) * sizeof(*pl->positions));
+
+      pl->size -= first;
+    }
+  }
+
+  csi->pruned = base;
+}
+
+// main functions
+void csi_clear(cnc_search_index *csi)
+{
+  if (csi == NULL || csi->buckets == NULL)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < csi->buckets_size; i++)
+  {
+    csi->buckets[i].size = 0;
+  }
+
+  csi->end    = 0;
+  csi->pruned = 0;
+}
+
+void csi_destroy(cnc_search_index *csi)
+{
+  if (csi == NULL || csi->buckets == NULL)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < csi->buckets_size; i++)
+  {
+    cal_free(csi->allocator, csi->buckets[i].positions);
+  }
+
+  cal_free(csi->allocator, csi->buckets);
+  csi->buckets      = NULL;
+  csi->buckets_size = 0;
+}
+
+bool csi_find(cnc_search_index *csi, const cnc_buffer *cb,
+              const cnc_buffer *pattern, size_t from, size_t *location)
+{
+  if (csi == NULL || cb == NULL || cb->data == NULL || pattern == NULL ||
+      pattern->data == NULL || pattern->size == 0 || location == NULL)
+  {
+    return false;
+  }
+
+  csi_sync(csi, cb);
+
+  size_t base = cb->dropped;
+  size_t end  = cb->dropped + cb->size;
+  size_t m    = pattern->size;
+
+  if (from < base)
+  {
+    from = base;
+  }
+
+  if (from >= end)
+  {
+    return false;
+  }
+
+  // short patterns have no gram: plain scan from the requested position
+  if (m < CSI_GRAM_SIZE || csi->buckets == NULL)
+  {
+    cb_search cs;
+    size_t    index;
+
+    cb_search_init(&cs, pattern);
+    cs.position = from - base;
+
+    if (cb_search_next(&cs, cb, &index) == false)
+    {
+      return false;
+    }
+
+    *location = base + index;
+
+    return true;
+  }
+
+  // use the most selective gram of the pattern
+  size_t        offset = 0;
+  csi_postings *pl     = NULL;
+
+  for (size_t k = 0; k + CSI_GRAM_SIZE <= m; k++)
+  {
+    size_t        hash      = _csi_hash(csi, &pattern->data[k]);
+    csi_postings *candidate = &csi->buckets[hash];
+
+    if (pl == NULL || candidate->size < pl->size)
+    {
+      pl     = candidate;
+      offset = k;
+    }
+  }
+
+  for (size_t i = _csi_lower_bound(pl, from + offset); i < pl->size; i++)
+  {
+    size_t start = pl->positions[i] - offset;
+
+    if (start + m > end)
+    {
+      break;
+    }
+
+    if (cb_match_at(cb, start - base, pattern))
+    {
+      *location = start;
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool csi_init(cnc_search_index *csi, const cnc_allocator *allocator,
+              size_t capacity)
+{
+  if (csi == NULL)
+  {
+    return false;
+  }
+
+  // posting lists for the text the buffer can hold
+  size_t buckets_size = CSI_BUCKETS_MIN;
+
+  while (buckets_size < CSI_BUCKETS_MAX &&
+         buckets_size * CSI_BUCKET_TOKENS < capacity)
+  {
+    buckets_size *= 2;
+  }
+
+  csi->allocator    = allocator;
+  csi->buckets_size = buckets_size;
+
+  csi->buckets = cal_alloc(allocator, buckets_size * sizeof(*csi->buckets));
+
+  if (csi->buckets == NULL)
+  {
+    return false;
+  }
+
+  memset(csi->buckets, 0, buckets_size * sizeof(*csi->buckets));
+
+  csi->end     = 0;
+  csi->pruned  = 0;
+  csi->version = 0;
+
+  return true;
+}
+
+void csi_sync(cnc_search_index *csi, const cnc_buffer *cb)
+{
+  if (csi == NULL || csi->buckets == NULL || cb == NULL || cb->data == NULL)
+  {
+    return;
+  }
+
+  size_t base = cb->dropped;
+  size_t end  = cb->dropped + cb->size;
+
+  // tokens already indexed were changed or removed: start over
+  if (csi->version != cb->version || end < csi->end)
+  {
+    csi_clear(csi);
+    csi->version = cb->version;
+  }
+
+  // evicted tokens (_cb_scroll) take their postings with them
+  if (csi->pruned < base)
+  {
+    _csi_prune(csi, base);
+  }
+
+  // grams that were incomplete at the last sync start CSI_GRAM_SIZE - 1
+  // tokens before the old end
+  size_t position =
+    csi->end >= CSI_GRAM_SIZE - 1 ? csi->end - (CSI_GRAM_SIZE - 1) : 0;
+
+  if (position < base)
+  {
+    position = base;
+  }
+
+  for (; position + CSI_GRAM_SIZE <= end; position++)
+  {
+    size_t hash = _csi_hash(csi, &cb->data[position - base]);
+
+    if (_csi_add(csi->allocator, &csi->buckets[hash], position) == false)
+    {
+      // out of memory: keep what we have, retry on the next sync
+      break;
+    }
+  }
+
+  csi->end =
+    position + CSI_GRAM_SIZE - 1 < end ? position + CSI_GRAM_SIZE - 1 : end;
+}
+
+void csi_trim(cnc_search_index *csi)
+{
+  if (csi == NULL || csi->buckets == NULL)
+  {
+    return;
+  }
+
+  // postings lists keep what they hold: memory given back after evictions
+  for (size_t i = 0; i < csi->buckets_size; i++)
+  {
+    csi_postings *pl = &csi->buckets[i];
+
+    if (pl->size == pl->capacity)
+    {
+      continue;
+    }
+
+    if (pl->size == 0)
+    {
+      cal_free(csi->allocator, pl->positions);
+
+      pl->positions = NULL;
+      pl->capacity  = 0;
+
+      continue;
+    }
+
+    size_t *new_positions = cal_realloc(csi->allocator, pl->positions,
+                                        pl->size * sizeof(*new_positions));
+
+    if (new_positions != NULL)
+    {
+      pl->positions = new_positions;
+      pl->capacity  = pl->size;
+    }
+  }
+}
+
+void csi_usage(const cnc_search_index *csi, cal_usage *usage)
+{
+  if (csi == NULL || csi->buckets == NULL || usage == NULL)
+  {
+    return;
+  }
+
+  usage->used += csi->buckets_size * sizeof(*csi->buckets);
+  usage->reserved += csi->buckets_size * sizeof(*csi->buckets);
+
+  for (size_t i = 0; i < csi->buckets_size; i++)
+  {
+    usage->used += csi->buckets[i].size * sizeof(size_t);
+    usage->reserved += csi->buckets[i].capacity * sizeof(size_t);
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef CNC_SEARCH_INDEX_H
+#define CNC_SEARCH_INDEX_H
+
+// using csi as shorthand for cnc_search_index
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cnc_buffer.h"
+
+// number of tokens hashed together for each posting
+#define CSI_GRAM_SIZE 3
+
+// number of posting lists (power of 2), one per CSI_BUCKET_TOKENS tokens
+// of the buffer capacity within these bounds
+#define CSI_BUCKETS_MIN   64
+#define CSI_BUCKETS_MAX   65536
+#define CSI_BUCKET_TOKENS 8
+
+// posting list initial capacity
+#define CSI_POSTINGS_INIT_CAP 16
+
+typedef struct
+{
+  size_t  size;
+  size_t  capacity;
+  size_t *positions; // absolute token positions, ascending
+
+} csi_postings;
+
+typedef struct
+{
+  const cnc_allocator *allocator;
+
+  csi_postings *buckets;
+  size_t        buckets_size; // power of 2
+
+  size_t end;     // absolute buffer end covered by the postings
+  size_t pruned;  // postings below this absolute position are gone
+  size_t version; // cnc_buffer version the postings were built from
+
+} cnc_search_index;
+
+// main functions
+void csi_clear(cnc_search_index *csi);
+void csi_destroy(cnc_search_index *csi);
+bool csi_find(cnc_search_index *csi, const cnc_buffer *cb,
+              const cnc_buffer *pattern, size_t from, size_t *location);
+bool csi_init(cnc_search_index *csi, const cnc_allocator *allocator,
+              size_t capacity);
+void csi_sync(cnc_search_index *csi, const cnc_buffer *cb);
+void csi_trim(cnc_search_index *csi);
+void csi_usage(const cnc_search_index *csi, cal_usage *usage);
+
+#endif
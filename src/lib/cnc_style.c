@@ -0,0 +1,134 @@
+#include "cnc_style.h"
+
+// private functions declaration
+static void   _cs_append_color(char **dst, uint32_t color, unsigned base);
+static void   _cs_append_number(char **dst, unsigned number);
+static size_t _cs_hash(cnc_style style);
+
+// private functions definition
+static void _cs_append_color(char **dst, uint32_t color, unsigned base)
+{
+  // base: 30 for foreground, 40 for background
+  uint32_t kind  = color >> 24;
+  uint32_t value = color & 0xFFFFFF;
+
+  switch (kind)
+  {
+    case 1:
+      _cs_append_number(dst, value < 8 ? base + value : base + 60 + value - 8);
+      break;
+
+    case 2:
+      _cs_append_number(dst, base + 8);
+      _cs_append_number(dst, 5);
+      _cs_append_number(dst, value);
+      break;
+
+    case 3:
+      _cs_append_number(dst, base + 8);
+      _cs_append_number(dst, 2);
+      _cs_append_number(dst, (value >> 16) & 0xFF);
+      _cs_append_number(dst, (value >> 8) & 0xFF);
+      _cs_append_number(dst, value & 0xFF);
+      break;
+
+    default:
+      break;
+  }
+}
+
+static void _cs_append_number(char **dst, unsigned number)
+{
+  // ';' separated SGR parameter
+  char   digits[10];
+  size_t count = 0;
+
+  do
+  {
+    digits[count++] = '0' + number % 10;
+    number /= 10;
+
+  } while (number > 0);
+
+  *(*dst)++ = ';';
+
+  while (count > 0)
+  {
+    *(*dst)++ = digits[--count];
+  }
+}
+
+static size_t _cs_hash(cnc_style style)
+{
+  style ^= style >> 29;
+  style *= 0x9E3779B97F4A7C15ull;
+
+  return (size_t)(style >> 32) & (CS_SGR_CACHE_SIZE - 1);
+}
+
+// main functions
+uint8_t cs_attributes(cnc_style style)
+{
+  return (uint8_t)(style >> (2 * CS_COLOR_BITS));
+}
+
+uint32_t cs_bg(cnc_style style)
+{
+  return (uint32_t)(style >> CS_COLOR_BITS) & CS_COLOR_MASK;
+}
+
+size_t cs_encode_sgr(cnc_style style, char *dst)
+{
+  // every sequence starts with a reset, so it fully defines the state
+  static const unsigned attribute_codes[8] = {1, 2, 3, 4, 5, 7, 8, 9};
+
+  char   *p          = dst;
+  uint8_t attributes = cs_attributes(style);
+
+  *p++ = '\x1b';
+  *p++ = '[';
+  *p++ = '0';
+
+  for (size_t i = 0; i < 8; i++)
+  {
+    if (attributes & (1u << i))
+    {
+      _cs_append_number(&p, attribute_codes[i]);
+    }
+  }
+
+  _cs_append_color(&p, cs_fg(style), 30);
+  _cs_append_color(&p, cs_bg(style), 40);
+
+  *p++ = 'm';
+
+  return p - dst;
+}
+
+uint32_t cs_fg(cnc_style style)
+{
+  return (uint32_t)style & CS_COLOR_MASK;
+}
+
+const cs_sgr_entry *cs_sgr_lookup(cs_sgr_cache *cache, cnc_style style)
+{
+  cs_sgr_entry *entry = &cache->entries[_cs_hash(style)];
+
+  // direct mapped: a miss encodes the style over the previous entry
+  if (entry->used == false || entry->style != style)
+  {
+    entry->style  = style;
+    entry->used   = true;
+    entry->length = (uint8_t)cs_encode_sgr(style, entry->bytes);
+  }
+
+  return entry;
+}
+
+void cs_sgr_reset(cs_sgr_cache *cache)
+{
+  for (size_t i = 0; i < CS_SGR_CACHE_SIZE; i++)
+  {
+    cache->entries[i].used = false;
+  }
+}
@@ -0,0 +1,102 @@
+#ifndef CNC_STYLE_H
+#define CNC_STYLE_H
+
+// using cs as shorthand for cnc_style
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+    Packed style word
+    -----------------
+    | bits  | content                                  |
+    | ----- | ---------------------------------------- |
+    |  0-25 | foreground color                         |
+    | 26-51 | background color                         |
+    | 52-59 | attributes (CS_BOLD, CS_UNDERLINE, ...)  |
+
+    Color (26 bits): 2 bits kind + 24 bits value
+    | kind | value                  | SGR            |
+    | ---- | ---------------------- | -------------- |
+    |    0 | terminal default       |                |
+    |    1 | 0-15 (ANSI colors)     | 30-37, 90-97   |
+    |    2 | 0-255 (xterm palette)  | 38;5;n         |
+    |    3 | 0xRRGGBB (truecolor)   | 38;2;r;g;b     |
+*/
+
+// colors
+#define CS_COLOR_BITS 26
+#define CS_COLOR_MASK ((1u << CS_COLOR_BITS) - 1)
+
+#define CS_DEFAULT_COLOR 0
+#define CS_ANSI(i)       ((1u << 24) | ((uint32_t)(i) & 0x0F))
+#define CS_C256(i)       ((2u << 24) | ((uint32_t)(i) & 0xFF))
+#define CS_RGB(r, g, b)                                                        \
+  ((3u << 24) | (((uint32_t)(r) & 0xFF) << 16) |                               \
+   (((uint32_t)(g) & 0xFF) << 8) | ((uint32_t)(b) & 0xFF))
+
+#define CS_BLACK   CS_ANSI(0)
+#define CS_RED     CS_ANSI(1)
+#define CS_GREEN   CS_ANSI(2)
+#define CS_YELLOW  CS_ANSI(3)
+#define CS_BLUE    CS_ANSI(4)
+#define CS_MAGENTA CS_ANSI(5)
+#define CS_CYAN    CS_ANSI(6)
+#define CS_WHITE   CS_ANSI(7)
+
+// attributes
+#define CS_BOLD      0x01
+#define CS_DIM       0x02
+#define CS_ITALIC    0x04
+#define CS_UNDERLINE 0x08
+#define CS_BLINK     0x10
+#define CS_INVERT    0x20
+#define CS_HIDDEN    0x40
+#define CS_STRIKE    0x80
+
+// terminal default colors, no attributes
+#define CS_DEFAULT 0
+
+// build a style word from 2 colors and attributes
+#define CS_STYLE(fg, bg, attributes)                                           \
+  ((cnc_style)((fg) & CS_COLOR_MASK) |                                         \
+   ((cnc_style)((bg) & CS_COLOR_MASK) << CS_COLOR_BITS) |                      \
+   ((cnc_style)((attributes) & 0xFF) << (2 * CS_COLOR_BITS)))
+
+// longest SGR sequence: ESC [ 0, 8 attributes, 2 truecolors, m
+#define CS_SGR_MAX 64
+
+// SGR cache entries (power of 2)
+#define CS_SGR_CACHE_SIZE 64
+
+typedef uint64_t cnc_style;
+
+typedef struct
+{
+  cnc_style style;
+  bool      used;
+  uint8_t   length;
+  char      bytes[CS_SGR_MAX];
+
+} cs_sgr_entry;
+
+// pre-encoded SGR strings, so emitting a style is a single memcpy
+typedef struct
+{
+  cs_sgr_entry entries[CS_SGR_CACHE_SIZE];
+
+} cs_sgr_cache;
+
+// main functions
+uint8_t  cs_attributes(cnc_style style);
+uint32_t cs_bg(cnc_style style);
+size_t   cs_encode_sgr(cnc_style style, char *dst);
+uint32_t cs_fg(cnc_style style);
+
+const cs_sgr_entry *cs_sgr_lookup(cs_sgr_cache *cache, cnc_style style);
+
+void cs_sgr_reset(cs_sgr_cache *cache);
+
+#endif
@@ -12,7 +12,9 @@ bool ctt_equal(const cnc_term_token *tkn1, const cnc_term_token *tkn2)
     return false;
   }
 
-  if (tkn1->token.width != tkn2->token.width)
+  // width is derived from the value: only compare it when both are known
+  if (tkn1->token.width != tkn2->token.width && tkn1->token.width != W_UNK &&
+      tkn2->token.width != W_UNK)
   {
     return false;
   }
@@ -51,6 +53,20 @@ bool ctt_is_whitespace(cnc_term_token tkn)
 
 bool ctt_parse_bytes(uint8_t *bytes, cnc_term_token *ctt)
 {
+  if (ctt_parse_bytes_lazy(bytes, ctt) == false)
+  {
+    return false;
+  }
+
+  ctt_resolve_width(ctt);
+
+  return true;
+}
+
+bool ctt_parse_bytes_lazy(uint8_t *bytes, cnc_term_token *ctt)
+{
+  // same as ctt_parse_bytes, but the (table lookup) width of UTF-8
+  // characters is left as W_UNK until ctt_resolve_width is called
   if (bytes == NULL || ctt == NULL)
   {
     return false;
@@ -106,7 +122,7 @@ bool ctt_parse_bytes(uint8_t *bytes, cnc_term_token *ctt)
     ctt->token.value = ((ctt->seq[0] & 0x1F) << W_1) | // last 5 bits of byte 1
                        ((ctt->seq[1] & 0x3F) << W_0);  // last 6 bits of byte 2
 
-    ctt->token.width = ctt_c_width(ctt->token.value);
+    ctt->token.width = W_UNK;
 
     return true;
   }
@@ -131,7 +147,7 @@ bool ctt_parse_bytes(uint8_t *bytes, cnc_term_token *ctt)
                        ((ctt->seq[1] & 0x3F) << W_1) | // last 6 bits of byte 2
                        ((ctt->seq[2] & 0x3F) << W_0);  // last 6 bits of byte 3
 
-    ctt->token.width = ctt_c_width(ctt->token.value);
+    ctt->token.width = W_UNK;
 
     return true;
   }
@@ -160,7 +176,7 @@ bool ctt_parse_bytes(uint8_t *bytes, cnc_term_token *ctt)
                        ((ctt->seq[2] & 0x3F) << W_1) | // last 6 bits of byte 3
                        ((ctt->seq[3] & 0x3F) << W_0);  // last 6 bits of byte 4
 
-    ctt->token.width = ctt_c_width(ctt->token.value);
+    ctt->token.width = W_UNK;
 
     return true;
   }
@@ -244,3 +260,18 @@ cnc_term_token ctt_parse_value(uint32_t value)
 
   return token;
 }
+
+ctt_width ctt_resolve_width(cnc_term_token *ctt)
+{
+  if (ctt == NULL)
+  {
+    return W_NIL;
+  }
+
+  if (ctt->token.width == W_UNK)
+  {
+    ctt->token.width = ctt_c_width(ctt->token.value);
+  }
+
+  return ctt->token.width;
+}
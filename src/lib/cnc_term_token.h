@@ -32,7 +32,6 @@
 
 // ASCII values Table
 #define C_NUL 0x00 // Null char '\0'
-#define C_COL 0x05 // Color Info Byte
 #define C_TAB 0x09 // Tab
 #define C_ENT 0x0A // Enter
 #define C_RET 0x0D // Return
@@ -103,7 +102,8 @@ typedef enum
 {
   W_NIL = 0, // 0 display byte
   W_ONE = 1, // 1 column width byte
-  W_TWO = 2  // 2 columns width byte
+  W_TWO = 2, // 2 columns width byte
+  W_UNK = 7  // not computed yet (lazy parsing), see ctt_resolve_width
 
 } ctt_width;
 
@@ -174,6 +174,8 @@ static const cnc_term_token ctt_ansi_tokens[] = {
 bool ctt_equal(const cnc_term_token *tkn1, const cnc_term_token *tkn2);
 bool ctt_is_whitespace(cnc_term_token tkn);
 bool ctt_parse_bytes(uint8_t *bytes, cnc_term_token *ctt);
+bool ctt_parse_bytes_lazy(uint8_t *bytes, cnc_term_token *ctt);
 cnc_term_token ctt_parse_value(uint32_t value);
+ctt_width      ctt_resolve_width(cnc_term_token *ctt);
 
 #endif
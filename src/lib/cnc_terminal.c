@@ -14,42 +14,99 @@ static void __handle__resize(int sig)
   resize_flag = 1;
 }
 
+// the rows of a file widget, drawn under cfv_guard (_ct_render_file)
+typedef struct
+{
+  cnc_terminal *ct;
+  cnc_widget   *cw;
+  char         *buf_ptr;
+
+} ct_file_rows;
+
 // private functions declarations
-// cursor functions
-static void _ct_c_clrscr();
-static void _ct_c_home_position();
-static void _ct_c_hide_cursor();
-static void _ct_c_show_cursor();
-static void _ct_c_cursor_ins();
-static void _ct_c_cursor_cmd();
-static void _ct_c_poscursor(size_t col, size_t row);
-
-// app functions
 static void _ct_check_for_suspend(cnc_terminal *ct);
-static int  _ct_color_code_to_color(int color_code, cnc_term_token *color);
+static void _ct_complete(cnc_terminal *ct);
+static void _ct_complete_show(cnc_terminal *ct, cnc_widget *cw,
+                              const char *text);
+
+static cnc_term_token _ct_decode(cnc_terminal *ct, size_t bytes_read);
+
 static void _ct_delete_char(cnc_terminal *ct);
+static int  _ct_dispatch(cnc_terminal *ct, cnc_term_token ctt_result);
+static bool _ct_drain_posts(cnc_terminal *ct);
+static void _ct_flush_output(cnc_terminal *ct);
+static bool _ct_frame_fits(cnc_terminal *ct, cnc_widget *cw);
+
+static ct_frame_stats *_ct_frame_stats(cnc_terminal *ct);
+
+static void _ct_frame_stats_add(ct_frame_stats *sum, ct_frame_stats *max,
+                                const ct_frame_stats *fs);
 
 static cnc_term_token _ct_getch(cnc_terminal *ct);
 
+static void   _ct_history_add(cnc_terminal *ct, cnc_widget *cw);
+static bool   _ct_history_key(cnc_terminal *ct, cnc_term_token ctt);
+static size_t _ct_history_label(cnc_terminal *ct, cnc_widget *cw);
+static void   _ct_history_next(cnc_terminal *ct);
+static void   _ct_history_prev(cnc_terminal *ct);
+static void   _ct_history_save(cnc_terminal *ct, cnc_widget *cw);
+static void   _ct_history_search(cnc_terminal *ct);
+static void   _ct_history_show(cnc_terminal *ct, cnc_widget *cw,
+                               const char *text);
+
 static void _ct_insert_char(cnc_widget *cw, char c);
 static void _ct_insert_token(cnc_widget *cw, cnc_term_token ctt_c);
+static void _ct_mark_dirty(cnc_terminal *ct, uint8_t bits);
+static bool _ct_memory_enforce(cnc_terminal *ct);
+
+static uint64_t _ct_now(void);
+
 static void _ct_page_dn(cnc_terminal *ct);
 static void _ct_page_up(cnc_terminal *ct);
 static void _ct_redraw(cnc_terminal *ct);
 static void _ct_render_append_token(char **dst_ptr, cnc_term_token token);
 static void _ct_render_border_row(char **buf_ptr, size_t row_width);
-static void _ct_render_color_set(char **buf_ptr, cnc_term_token bg,
-                                 cnc_term_token fg);
 static void _ct_render_color_reset(char **buf_ptr);
-static void _ct_render_data(char **buf_ptr, cnc_buffer *src, size_t start_index,
-                            size_t upper_bound, size_t row_width);
+static void _ct_render_completion(cnc_terminal *ct, char **buf_ptr);
+static void _ct_render_cursor(cnc_terminal *ct, char **buf_ptr);
+static void _ct_render_data(cnc_terminal *ct, char **buf_ptr, cnc_buffer *src,
+                            size_t start_index, size_t upper_bound,
+                            size_t row_width);
 static void _ct_render_empty_row(char **buf_ptr, size_t row_width);
 static void _ct_render_enter(char **buf_ptr);
+static void _ct_render_file(cnc_terminal *ct, cnc_widget *cw, char **buf_ptr);
+static void _ct_render_file_rows(void *context);
+
+static void *_ct_render_main(void *arg);
+
+static void _ct_render_publish(cnc_terminal *ct);
+static void _ct_render_row_start(cnc_terminal *ct, cnc_widget *cw,
+                                 char **buf_ptr, size_t row);
+static void _ct_render_stats(cnc_terminal *ct, char **buf_ptr,
+                             size_t row_width);
+static void _ct_render_str(char **buf_ptr, const char *str);
+static void _ct_render_style(cnc_terminal *ct, char **buf_ptr,
+                             cnc_style style);
+static void _ct_render_sync(cnc_terminal *ct);
+static bool _ct_reserve_bytes(cnc_terminal *ct, char **buf_ptr,
+                              char **rendered, size_t length);
+static bool _ct_reserve_screenbuffer(cnc_terminal *ct);
+static bool _ct_reserve_text(cnc_terminal *ct, char **buf_ptr, char **rendered,
+                             cnc_buffer *cb, size_t start, size_t end);
 static void _ct_restore(cnc_terminal *ct);
+
+static size_t _ct_screenbuffer_size(cnc_terminal *ct);
+static void   _ct_scroll(cnc_widget *cw, ptrdiff_t rows);
+
+static bool _ct_search_first(cnc_terminal *ct, cnc_widget *cw);
+static bool _ct_search_jump(cnc_terminal *ct, cnc_widget *cw, size_t from);
+
 static void _ct_set_mode_cmd(cnc_terminal *ct);
 static void _ct_set_mode_ins(cnc_terminal *ct);
 static bool _ct_set_raw_mode(cnc_terminal *ct);
 
+static cnc_widget *_ct_target_display(cnc_terminal *ct);
+
 // Vim-Like functions
 // vm -> vim_mode
 static void _ct_vm_0(cnc_terminal *ct);
@@ -62,179 +119,156 @@ static void _ct_vm_h(cnc_terminal *ct);
 static void _ct_vm_j(cnc_terminal *ct);
 static void _ct_vm_k(cnc_terminal *ct);
 static void _ct_vm_l(cnc_terminal *ct);
+static void _ct_vm_n(cnc_terminal *ct);
+static void _ct_vm_slash(cnc_terminal *ct);
 static void _ct_vm_x(cnc_terminal *ct);
 
 // private function definitions
-static void _ct_c_clrscr()
+static void _ct_check_for_suspend(cnc_terminal *ct)
 {
-  // if (write(STDOUT_FILENO, "\x1b[2J\x1b[3J", 8) == -1)
-  if (write(STDOUT_FILENO, "\x1b\x63", 2) == -1)
+  if (ct == NULL)
   {
+    return;
   }
-}
 
-static void _ct_c_home_position()
-{
-  if (write(STDOUT_FILENO, "\x1b[H", 3) == -1)
+  if (suspend_flag)
   {
-  }
-}
+    suspend_flag = 0;
 
-static void _ct_c_hide_cursor()
-{
-  if (write(STDOUT_FILENO, "\x1b[?25l", 6) == -1)
-  {
-  }
-}
+    _ct_restore(ct);
 
-static void _ct_c_show_cursor()
-{
-  if (write(STDOUT_FILENO, "\x1b[?25h", 6) == -1)
-  {
-  }
-}
+    // Set default handler for SIGTSTP
+    signal(SIGTSTP, SIG_DFL);
 
-static void _ct_c_cursor_ins()
-{
-  if (write(STDOUT_FILENO, "\x1b[5 q", 5) == -1)
-  {
+    // Send SIGTSTP to itself to suspend the process
+    raise(SIGTSTP);
   }
-}
 
-static void _ct_c_cursor_cmd()
-{
-  if (write(STDOUT_FILENO, "\x1b[1 q", 5) == -1)
+  else
   {
+    if (ct->in_raw_mode == false)
+    {
+      _ct_set_raw_mode(ct);
+      ct_update(ct);
+    }
   }
 }
 
-static void _ct_c_poscursor(size_t col, size_t row)
+static void _ct_complete(cnc_terminal *ct)
 {
-  if (write(STDOUT_FILENO, "\x1b[", 2) == -1)
+  ct_completion *cc = &ct->completion;
+  cnc_widget    *fw = ct->focused_widget;
+
+  if (cc->candidates == NULL)
   {
+    ct_focus_next(ct);
+
     return;
   }
 
-  char __buf[43];
-  int  __len = sprintf(__buf, "%zu;%zuH", (size_t)(row), (size_t)(col));
+  char text[CCP_TEXT_MAX];
 
-  if (write(STDOUT_FILENO, __buf, __len) == -1)
+  // Tab again: the next match, and the typed word after the last one
+  if (cc->open)
   {
-  }
-}
+    cc->index = (cc->index + 1) % (cc->match.count + 1);
+
+    if (cc->index == cc->match.count ||
+        ccp_get(cc->candidates, &cc->match, cc->index, text, sizeof(text)) ==
+          0)
+    {
+      text[0] = '\0';
+    }
+
+    _ct_complete_show(ct, fw, text);
 
-static void _ct_check_for_suspend(cnc_terminal *ct)
-{
-  if (ct == NULL)
-  {
     return;
   }
 
-  if (suspend_flag)
+  // the word before the cursor
+  size_t start  = fw->data_index;
+  size_t length = 0;
+
+  while (start > 0 && ctt_is_whitespace(fw->buffer.data[start - 1]) == false)
   {
-    suspend_flag = 0;
+    start--;
+  }
 
-    _ct_restore(ct);
+  for (size_t i = start; i < fw->data_index; i++)
+  {
+    cnc_term_token *t = &fw->buffer.data[i];
 
-    // Set default handler for SIGTSTP
-    signal(SIGTSTP, SIG_DFL);
+    if (length + t->token.length >= CCP_TEXT_MAX)
+    {
+      return;
+    }
 
-    // Send SIGTSTP to itself to suspend the process
-    raise(SIGTSTP);
+    memcpy(cc->word + length, t->seq, t->token.length);
+    length += t->token.length;
   }
 
-  else
+  if (ccp_find(cc->candidates, cc->word, length, &cc->match) == false)
   {
-    if (ct->in_raw_mode == false)
-    {
-      _ct_set_raw_mode(ct);
-      ct_update(ct);
-    }
+    return;
   }
-}
 
-static int _ct_color_code_to_color(int color_code, cnc_term_token *color)
-{
-  if (color == NULL)
+  cc->word_length = length;
+  cc->start       = start;
+  cc->typed       = fw->data_index - start;
+  cc->index       = cc->match.count;
+
+  // what every match goes on with is typed in, else the matches are listed
+  if (ccp_common(cc->candidates, &cc->match, text, sizeof(text)) > 0)
   {
-    return 0;
+    _ct_complete_show(ct, fw, text);
   }
 
-  switch (color_code)
-  {
-    case KS_BLA_FG:
-      *color = ctt_parse_value(KS_BLA_FG);
-      return 2;
-    case KS_RED_FG:
-      *color = ctt_parse_value(KS_RED_FG);
-      return 2;
-    case KS_GRE_FG:
-      *color = ctt_parse_value(KS_GRE_FG);
-      return 2;
-    case KS_YEL_FG:
-      *color = ctt_parse_value(KS_YEL_FG);
-      return 2;
-    case KS_BLU_FG:
-      *color = ctt_parse_value(KS_BLU_FG);
-      return 2;
-    case KS_MAG_FG:
-      *color = ctt_parse_value(KS_MAG_FG);
-      return 2;
-    case KS_CYA_FG:
-      *color = ctt_parse_value(KS_CYA_FG);
-      return 2;
-    case KS_WHI_FG:
-      *color = ctt_parse_value(KS_WHI_FG);
-      return 2;
-    case KS_BLA_BG:
-      *color = ctt_parse_value(KS_BLA_BG);
-      return 1;
-    case KS_RED_BG:
-      *color = ctt_parse_value(KS_RED_BG);
-      return 1;
-    case KS_GRE_BG:
-      *color = ctt_parse_value(KS_GRE_BG);
-      return 1;
-    case KS_YEL_BG:
-      *color = ctt_parse_value(KS_YEL_BG);
-      return 1;
-    case KS_BLU_BG:
-      *color = ctt_parse_value(KS_BLU_BG);
-      return 1;
-    case KS_MAG_BG:
-      *color = ctt_parse_value(KS_MAG_BG);
-      return 1;
-    case KS_CYA_BG:
-      *color = ctt_parse_value(KS_CYA_BG);
-      return 1;
-    case KS_WHI_BG:
-      *color = ctt_parse_value(KS_WHI_BG);
-      return 1;
-
-    default:
-      return 0;
+  else if (cc->match.count > 1)
+  {
+    cc->open = true;
   }
 }
 
-static cnc_term_token _ct_getch(cnc_terminal *ct)
+static void _ct_complete_show(cnc_terminal *ct, cnc_widget *cw,
+                              const char *text)
 {
-  if (ct == NULL)
+  // text follows the typed word, in place of the match shown before
+  while (cw->data_index > ct->completion.start + ct->completion.typed)
   {
-    return (cnc_term_token){0};
+    _ct_delete_char(ct);
+  }
+
+  while (*text != '\0' && cw->buffer.size < cw->buffer.max_capacity)
+  {
+    cnc_term_token token = {0};
+
+    if (ctt_parse_bytes((uint8_t *)text, &token) == false ||
+        token.token.length == 0)
+    {
+      break;
+    }
+
+    _ct_insert_token(cw, token);
+    text += token.token.length;
   }
 
-  int bytes_read = 0;
+  // a match as long as the one it replaces leaves the buffer size alone
+  cw_mark_dirty(cw, CW_DIRTY_CONTENT);
+}
 
-  ioctl(STDIN_FILENO, FIONREAD, &bytes_read);
+static cnc_term_token _ct_decode(cnc_terminal *ct, size_t bytes_read)
+{
+  cnc_backend *be = &ct->backend;
 
-  if (bytes_read <= 0)
+  // an escape sequence longer than a token is cut
+  if (bytes_read > CTT_MAX_TOKEN_SIZE)
   {
-    return (cnc_term_token){0};
+    bytes_read = CTT_MAX_TOKEN_SIZE;
   }
 
   uint8_t ch[CTT_MAX_TOKEN_SIZE] = {0};
 
-  if (read(STDIN_FILENO, &ch[0], 1) == 1 && bytes_read == 1)
+  if (be->read(be->context, &ch[0], 1) == 1 && bytes_read == 1)
   {
     return ctt_parse_value(ch[0]);
   }
@@ -258,9 +292,9 @@ static cnc_term_token _ct_getch(cnc_terminal *ct)
     }
 
     // Already read 1 byte; read the rest
-    for (int i = 1; i < utf8_len && i < bytes_read; ++i)
+    for (size_t i = 1; i < (size_t)utf8_len && i < bytes_read; ++i)
     {
-      if (read(STDIN_FILENO, &ch[i], 1) == 1 && (ch[i] & 0xC0) != 0x80)
+      if (be->read(be->context, &ch[i], 1) == 1 && (ch[i] & 0xC0) != 0x80)
       {
         // Invalid continuation byte
         return ctt_parse_value(ch[0]);
@@ -276,9 +310,9 @@ static cnc_term_token _ct_getch(cnc_terminal *ct)
   // ch[0] is an escape => ANSI Escape Code
   uint32_t ch_sum = ch[0];
 
-  for (int i = 1; i < bytes_read; i++)
+  for (size_t i = 1; i < bytes_read; i++)
   {
-    if (read(STDIN_FILENO, &ch[i], 1) == 1)
+    if (be->read(be->context, &ch[i], 1) == 1)
     {
       ch_sum += ch[i];
     }
@@ -287,164 +321,601 @@ static cnc_term_token _ct_getch(cnc_terminal *ct)
   return ctt_parse_value(ch_sum);
 }
 
-static void _ct_insert_char(cnc_widget *cw, char c)
+static int _ct_dispatch(cnc_terminal *ct, cnc_term_token ctt_result)
 {
-  cnc_term_token ctt_c = ctt_parse_value(c);
-  _ct_insert_token(cw, ctt_c);
-}
+  cnc_widget *fw     = ct->focused_widget;
+  int         result = ctt_result.token.value;
 
-static void _ct_insert_token(cnc_widget *cw, cnc_term_token ctt_c)
-{
-  if (cw && cw->type == WIDGET_PROMPT)
+  // build the commands map
+  CommandMap commands[] = {
+    {C_BCK,         _ct_delete_char },
+    {KS_ARR_UP,     _ct_vm_k        },
+    {'k',           _ct_vm_k        },
+    {KS_ARR_DN,     _ct_vm_j        },
+    {'j',           _ct_vm_j        },
+    {KS_ARR_RT,     _ct_vm_l        },
+    {'l',           _ct_vm_l        },
+    {KS_ARR_LT,     _ct_vm_h        },
+    {'h',           _ct_vm_h        },
+    {'e',           _ct_vm_e        },
+    {'b',           _ct_vm_b        },
+    {KS_PAG_UP,     _ct_page_up     },
+    {KS_PAG_DN,     _ct_page_dn     },
+    {C_ESC,         _ct_set_mode_cmd},
+    {CTRL_KEY('c'), _ct_set_mode_cmd},
+    {KS_INS___,     _ct_set_mode_ins},
+    {'i',           _ct_set_mode_ins},
+    {C_TAB,         ct_focus_next   },
+    {'a',           _ct_vm_a        },
+    {'A',           _ct_vm_aa       },
+    {'0',           _ct_vm_0        },
+    {'$',           _ct_vm_$        },
+    {'x',           _ct_vm_x        },
+    {'/',           _ct_vm_slash    },
+    {'n',           _ct_vm_n        },
+    {'\0',          NULL            }  // end of map array
+  };
+
+  // prompt history and completion keys
+  CommandMap prompt_commands[] = {
+    {KS_ARR_UP,     _ct_history_prev  },
+    {KS_ARR_DN,     _ct_history_next  },
+    {CTRL_KEY('r'), _ct_history_search},
+    {C_TAB,         _ct_complete      },
+    {'\0',          NULL              }  // end of map array
+  };
+
+  // only when prompt has focus
+  if (ct->mode == MODE_INS && fw && fw->type == WIDGET_PROMPT)
   {
-    if (cb_insert(&cw->buffer, ctt_c, cw->data_index))
+    // reverse search takes its keys, any other key ends it
+    if (ct->history_search && _ct_history_key(ct, ctt_result))
     {
-      cw->data_index++;
+      return result;
+    }
 
-      if (cb_data_width(&cw->buffer, cw->index,
-                        cw->data_index - cw->index + 1) +
-            PROMPT_PAD + ctt_c.token.width >
-          cw->frame.width)
-      {
-        ctt_width first_char_width = cw->buffer.data[cw->index].token.width;
+    // the listed matches stay while Tab cycles them
+    if (result != C_TAB)
+    {
+      ct->completion.open = false;
+    }
 
-        if (first_char_width == ctt_c.token.width)
-        {
-          cw->index++;
-        }
+    // user presses ENTER key on a WIDGET_PROMPT
+    if (result == C_ENT || result == C_RET)
+    {
+      result = C_ENT;
 
-        else
-        {
-          cw->index += ctt_c.token.width;
-        }
-      }
+      // the app resets the prompt: the line is kept in the history first
+      _ct_history_add(ct, fw);
+
+      return result;
     }
-  }
-}
 
-static void _ct_page_dn(cnc_terminal *ct)
-{
-  if (ct == NULL)
-  {
-    return;
-  }
+    for (size_t i = 0; prompt_commands[i].key != 0; i++)
+    {
+      if (prompt_commands[i].key == result)
+      {
+        prompt_commands[i].func(ct);
 
-  cnc_widget *fw = ct->focused_widget;
-  cnc_widget *dw = ct->main_display_widget;
+        return result;
+      }
+    }
 
-  if (fw && fw->type == WIDGET_DISPLAY)
-  {
-    if (fw->index + 2 * (fw->frame.height - 2) < fw->data_index)
+    // result is a valid character
+    if (result >= C_SPC && result <= C_TLD)
     {
-      fw->index += (fw->frame.height - 2);
+      if (fw->buffer.size < fw->buffer.max_capacity)
+      {
+        _ct_insert_char(fw, result);
+      }
 
-      return;
+      return result;
     }
 
-    if (fw->index + 2 * fw->frame.height > fw->data_index)
+    // ctt_result is UTF8
+    if (ctt_result.token.type == CTT_UTF8)
     {
-      fw->index = fw->data_index - fw->frame.height;
-    }
+      if (fw->buffer.size < fw->buffer.max_capacity)
+      {
+        _ct_insert_token(fw, ctt_result);
+      }
 
-    return;
+      return ctt_result.token.value;
+    }
   }
 
-  if (dw && dw->type == WIDGET_DISPLAY)
+  for (size_t i = 0; commands[i].key != 0; i++)
   {
-    if (dw->index + 2 * (dw->frame.height - 2) < dw->data_index)
+    if (commands[i].key == result)
     {
-      dw->index += (dw->frame.height - 2);
+      commands[i].func(ct);
 
-      return;
+      return result;
     }
+  }
+
+  return result;
+}
+
+static bool _ct_drain_posts(cnc_terminal *ct)
+{
+  bool drained = false;
+
+  // a batch per widget, so that busy producers cannot starve the frame
+  for (size_t i = 0; i < ct->widgets_count; i++)
+  {
+    cnc_widget *cw = ct->widgets[i];
 
-    if (dw->index + 2 * dw->frame.height > dw->data_index)
+    for (size_t n = 0; cw && n < CT_POST_BATCH; n++)
     {
-      dw->index = dw->data_index - dw->frame.height;
+      cq_node *node = cq_pop(&cw->posts);
+
+      if (node == NULL)
+      {
+        break;
+      }
+
+      cb_append_bytes(&cw->buffer, cq_bytes(node), node->length);
+      cq_free(node);
+
+      drained = true;
     }
   }
+
+  return drained;
 }
 
-static void _ct_page_up(cnc_terminal *ct)
+static void _ct_flush_output(cnc_terminal *ct)
 {
-  if (ct == NULL)
+  // the render thread flushes on its own
+  if (ct->render_running == false)
   {
-    return;
+    co_flush(&ct->output);
   }
+}
 
-  cnc_widget *fw = ct->focused_widget;
-  cnc_widget *dw = ct->main_display_widget;
+static bool _ct_frame_fits(cnc_terminal *ct, cnc_widget *cw)
+{
+  // a widget is drawn only within the screen, with room for its rows
+  const cnc_rect *frame = &cw->frame;
+  size_t          rows  = 2;
 
-  if (fw && fw->type == WIDGET_DISPLAY)
+  if (cw->type == WIDGET_DISPLAY || cw->type == WIDGET_FILE)
   {
-    if (fw->index > fw->frame.height)
-    {
-      fw->index -= (fw->frame.height - 2);
-    }
-
-    else
-    {
-      fw->index = 0;
-    }
-
-    return;
+    rows = 1;
   }
 
-  if (dw && dw->type == WIDGET_DISPLAY)
-  {
-    if (dw->index > dw->frame.height)
-    {
-      dw->index -= (dw->frame.height - 2);
-    }
+  return frame->origin.row >= 1 && frame->origin.col >= 1 &&
+         frame->height >= rows && frame->width > PROMPT_PAD &&
+         frame->origin.row - 1 + frame->height <= ct->scr_rows &&
+         frame->origin.col - 1 + frame->width <= ct->scr_cols;
+}
 
-    else
-    {
-      dw->index = 0;
-    }
-  }
+static ct_frame_stats *_ct_frame_stats(cnc_terminal *ct)
+{
+  // the frame being built
+  return &ct->stats[ct->stats_count % CT_STATS_WINDOW];
 }
 
-static void _ct_redraw(cnc_terminal *ct)
+static void _ct_frame_stats_add(ct_frame_stats *sum, ct_frame_stats *max,
+                                const ct_frame_stats *fs)
+{
+  sum->layout_ns += fs->layout_ns;
+  sum->render_ns += fs->render_ns;
+  sum->write_ns += fs->write_ns;
+  sum->rows_wrapped += fs->rows_wrapped;
+  sum->tokens += fs->tokens;
+  sum->bytes += fs->bytes;
+  sum->syscalls += fs->syscalls;
+
+  max->layout_ns = fs->layout_ns > max->layout_ns ? fs->layout_ns
+                                                  : max->layout_ns;
+  max->render_ns = fs->render_ns > max->render_ns ? fs->render_ns
+                                                  : max->render_ns;
+  max->write_ns  = fs->write_ns > max->write_ns ? fs->write_ns : max->write_ns;
+  max->rows_wrapped = fs->rows_wrapped > max->rows_wrapped ? fs->rows_wrapped
+                                                           : max->rows_wrapped;
+  max->tokens   = fs->tokens > max->tokens ? fs->tokens : max->tokens;
+  max->bytes    = fs->bytes > max->bytes ? fs->bytes : max->bytes;
+  max->syscalls = fs->syscalls > max->syscalls ? fs->syscalls : max->syscalls;
+}
+
+static cnc_term_token _ct_getch(cnc_terminal *ct)
 {
   if (ct == NULL)
   {
-    return;
+    return (cnc_term_token){0};
   }
 
-  _ct_c_hide_cursor();
-  _ct_c_home_position();
+  cnc_backend *be         = &ct->backend;
+  size_t       bytes_read = be->pending(be->context);
 
-  // check if terminal dimensions are within limits
-  if (ct->scr_cols < ct->min_width || ct->scr_rows < ct->min_height)
+  if (bytes_read == 0)
   {
-    printf(".. Please resize your terminal\n\r");
-    printf(".. Terminal Size: R=%4zu, C=%4zu\n\r", ct->scr_rows, ct->scr_cols);
-    printf("..      Min Size: R=%4zu, C=%4zu\n\r", ct->min_height,
-           ct->min_width);
+    return (cnc_term_token){0};
+  }
+
+  CTR_BEGIN("input decode");
+  cnc_term_token ctt_result = _ct_decode(ct, bytes_read);
+  CTR_END("input decode");
+
+  return ctt_result;
+}
+
+static void _ct_history_add(cnc_terminal *ct, cnc_widget *cw)
+{
+  size_t length = cb_data_length(&cw->buffer, 0, cw->buffer.size);
+  char  *text   = cal_alloc(&ct->allocator, length + 1);
 
-    fflush(stdout);
+  if (text == NULL)
+  {
     return;
   }
 
-  // write ct->screenbuffer to terminal
-  if (write(STDOUT_FILENO, ct->screenbuffer, strlen(ct->screenbuffer)) == -1)
+  if (cb_set_c_str(&cw->buffer, text, length + 1))
   {
+    ch_add(&ct->history, text, strlen(text));
   }
 
-  cnc_widget *cw = ct_focused_widget(ct);
+  cal_free(&ct->allocator, text);
+}
+
+static bool _ct_history_key(cnc_terminal *ct, cnc_term_token ctt)
+{
+  cnc_widget  *fw     = ct->focused_widget;
+  cnc_history *ch     = &ct->history;
+  cnc_buffer  *query  = &ct->history_query;
+  int          key    = ctt.token.value;
+  size_t       length = ch->query_length;
+  size_t       match  = CH_NONE;
+
+  // keys typed into the query
+  bool printed = (key >= C_SPC && key <= C_TLD) || ctt.token.type == CTT_UTF8;
+
+  if (key == CTRL_KEY('r'))
+  {
+    match = ch_search_older(ch);
+  }
+
+  else if (key == C_BCK)
+  {
+    match = ch_search_pop(ch);
+
+    if (length > 0)
+    {
+      cb_remove(query, query->size - 1);
+    }
+  }
+
+  else if (printed)
+  {
+    match = ch_search_push(ch, (const char *)ctt.seq, ctt.token.length);
+
+    // a full query takes no more keys
+    if (ch->query_length > length)
+    {
+      cb_push(query, ctt);
+    }
+  }
+
+  // cancelled: back to the typed line
+  else if (key == C_ESC || key == CTRL_KEY('c') || key == CTRL_KEY('g'))
+  {
+    ct->history_search = false;
+    _ct_history_show(ct, fw, NULL);
+
+    return true;
+  }
+
+  // any other key takes the match and does what it always does
+  else
+  {
+    ct->history_search = false;
+    cw_mark_dirty(fw, CW_DIRTY_CONTENT);
+
+    return false;
+  }
+
+  // no match for the query: the last match stays
+  if (match != CH_NONE)
+  {
+    _ct_history_show(ct, fw, ch_get(ch, match, NULL));
+  }
+
+  else if (ch->query_length == 0)
+  {
+    _ct_history_show(ct, fw, NULL);
+  }
+
+  // the query is drawn with the prompt
+  cw_mark_dirty(fw, CW_DIRTY_CONTENT);
+
+  return true;
+}
+
+static size_t _ct_history_label(cnc_terminal *ct, cnc_widget *cw)
+{
+  if (ct->history_search == false || cw != ct->focused_widget)
+  {
+    return 0;
+  }
+
+  // "(query) " before the line, unless it leaves too little room
+  size_t width =
+    cb_data_width(&ct->history_query, 0, ct->history_query.size) + 3;
+
+  return width <= (cw->frame.width - PROMPT_PAD) / 2 ? width : 0;
+}
+
+static void _ct_history_next(cnc_terminal *ct)
+{
+  cnc_history *ch = &ct->history;
+
+  if (ch->browse >= ch->first + ch->size)
+  {
+    return;
+  }
+
+  // past the newest entry: the typed line again
+  _ct_history_show(ct, ct->focused_widget, ch_next(ch, NULL));
+}
+
+static void _ct_history_prev(cnc_terminal *ct)
+{
+  cnc_history *ch   = &ct->history;
+  const char  *text = NULL;
+
+  if (ch->browse == ch->first + ch->size)
+  {
+    _ct_history_save(ct, ct->focused_widget);
+  }
 
+  text = ch_prev(ch, NULL);
+
+  if (text != NULL)
+  {
+    _ct_history_show(ct, ct->focused_widget, text);
+  }
+}
+
+static void _ct_history_save(cnc_terminal *ct, cnc_widget *cw)
+{
+  // the typed line, as long as the prompt can hold
+  if (ct->history_line.max_capacity < cw->buffer.max_capacity)
+  {
+    cb_set_max_capacity(&ct->history_line, cw->buffer.max_capacity);
+  }
+
+  cb_set_buf(&ct->history_line, &cw->buffer);
+}
+
+static void _ct_history_search(cnc_terminal *ct)
+{
+  cnc_widget *fw = ct->focused_widget;
+
+  _ct_history_save(ct, fw);
+  ch_rewind(&ct->history);
+  ch_search_begin(&ct->history);
+  cb_clear(&ct->history_query);
+
+  ct->history_search = true;
+  cw_mark_dirty(fw, CW_DIRTY_CONTENT);
+}
+
+static void _ct_history_show(cnc_terminal *ct, cnc_widget *cw,
+                             const char *text)
+{
+  // NULL: the line typed before browsing
+  if (text == NULL)
+  {
+    cb_set_buf(&cw->buffer, &ct->history_line);
+  }
+
+  else
+  {
+    cb_set_txt(&cw->buffer, text);
+  }
+
+  // the cursor at the end of the line, in view
+  size_t room = cw->frame.width - PROMPT_PAD - 1 - _ct_history_label(ct, cw);
+
+  cw->data_index = cw->buffer.size;
+  cw->index      = 0;
+
+  while (cw->index < cw->data_index &&
+         cb_data_width(&cw->buffer, cw->index, cw->data_index - cw->index) >
+           room)
+  {
+    cw->index++;
+  }
+}
+
+static void _ct_insert_char(cnc_widget *cw, char c)
+{
+  cnc_term_token ctt_c = ctt_parse_value(c);
+  _ct_insert_token(cw, ctt_c);
+}
+
+static void _ct_insert_token(cnc_widget *cw, cnc_term_token ctt_c)
+{
   if (cw && cw->type == WIDGET_PROMPT)
   {
-    cc_set_position(
-      &ct->cursor, cw->frame.origin.row + 1,
-      1 + PROMPT_PAD +
-        cb_data_width(&cw->buffer, cw->index, cw->data_index - cw->index));
+    if (cb_insert(&cw->buffer, ctt_c, cw->data_index))
+    {
+      cw->data_index++;
+
+      if (cb_data_width(&cw->buffer, cw->index,
+                        cw->data_index - cw->index + 1) +
+            PROMPT_PAD + ctt_c.token.width >
+          cw->frame.width)
+      {
+        ctt_width first_char_width = cw->buffer.data[cw->index].token.width;
 
-    _ct_c_poscursor(ct->cursor.col, ct->cursor.row);
-    _ct_c_show_cursor();
+        if (first_char_width == ctt_c.token.width)
+        {
+          cw->index++;
+        }
+
+        else
+        {
+          cw->index += ctt_c.token.width;
+        }
+      }
+    }
   }
+}
 
-  fflush(stdout);
+static void _ct_mark_dirty(cnc_terminal *ct, uint8_t bits)
+{
+  for (size_t i = 0; i < ct->widgets_count; i++)
+  {
+    cw_mark_dirty(ct->widgets[i], bits);
+  }
+}
+
+static bool _ct_memory_enforce(cnc_terminal *ct)
+{
+  /*
+   * over budget, display scrollback goes first: the largest display buffer
+   * is halved (its oldest text is evicted) and keeps that capacity, so it
+   * scrolls from then on instead of growing back. its line and search
+   * indexes follow, until the budget is met or the buffers are down to
+   * CB_INIT_CAP tokens.
+   */
+
+  ct_memory memory;
+
+  // no budget, nothing to measure: the walk visits every index and entry
+  if (ct->memory_budget == 0)
+  {
+    return true;
+  }
+
+  for (;;)
+  {
+    ct_memory_usage(ct, &memory);
+
+    if (memory.total.reserved <= ct->memory_budget)
+    {
+      return true;
+    }
+
+    cnc_widget *victim = NULL;
+
+    for (size_t i = 0; i < ct->widgets_count; i++)
+    {
+      cnc_widget *cw = ct->widgets[i];
+
+      if (cw->type == WIDGET_DISPLAY && cw->buffer.capacity > CB_INIT_CAP &&
+          (victim == NULL || cw->buffer.capacity > victim->buffer.capacity))
+      {
+        victim = cw;
+      }
+    }
+
+    if (victim == NULL)
+    {
+      return false;
+    }
+
+    size_t capacity = victim->buffer.capacity / 2;
+
+    if (capacity < CB_INIT_CAP)
+    {
+      capacity = CB_INIT_CAP;
+    }
+
+    if (cb_set_max_capacity(&victim->buffer, capacity) == false)
+    {
+      return false;
+    }
+
+    cwc_sync(&victim->wrap, &victim->buffer);
+    cwc_trim(&victim->wrap);
+    csi_sync(&victim->search, &victim->buffer);
+    csi_trim(&victim->search);
+  }
+}
+
+static uint64_t _ct_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void _ct_page_dn(cnc_terminal *ct)
+{
+  if (ct == NULL)
+  {
+    return;
+  }
+
+  cnc_widget *cw = _ct_target_display(ct);
+
+  if (cw)
+  {
+    _ct_scroll(cw, (ptrdiff_t)cw->frame.height - 2);
+  }
+}
+
+static void _ct_page_up(cnc_terminal *ct)
+{
+  if (ct == NULL)
+  {
+    return;
+  }
+
+  cnc_widget *cw = _ct_target_display(ct);
+
+  if (cw)
+  {
+    _ct_scroll(cw, 2 - (ptrdiff_t)cw->frame.height);
+  }
+}
+
+static void _ct_redraw(cnc_terminal *ct)
+{
+  if (ct == NULL)
+  {
+    return;
+  }
+
+  // check if terminal dimensions are within limits
+  if (ct->scr_cols < ct->min_width || ct->scr_rows < ct->min_height)
+  {
+    int length = snprintf(
+      ct->screenbuffer, ct->screenbuffer_size,
+      STR_FRAME_BEGIN ".. Please resize your terminal\n\r"
+                      ".. Terminal Size: R=%4zu, C=%4zu\n\r"
+                      "..      Min Size: R=%4zu, C=%4zu\n\r",
+      ct->scr_rows, ct->scr_cols, ct->min_height, ct->min_width);
+
+    ct->frame_size = length < 0 ? 0 : (size_t)length;
+
+    if (ct->frame_size >= ct->screenbuffer_size)
+    {
+      ct->frame_size = ct->screenbuffer_size - 1;
+    }
+  }
+
+  // write ct->screenbuffer to terminal, or hand it to the render thread
+  CTR_BEGIN("output");
+
+  if (ct->render_running)
+  {
+    _ct_render_publish(ct);
+  }
+
+  else
+  {
+    co_submit(&ct->output, ct->screenbuffer, ct->frame_size);
+    co_flush(&ct->output);
+  }
+
+  CTR_END("output");
 }
 
 static void _ct_render_append_token(char **dst_ptr, cnc_term_token token)
@@ -463,21 +934,110 @@ static void _ct_render_border_row(char **buf_ptr, size_t row_width)
   }
 }
 
-static void _ct_render_color_set(char **buf_ptr, cnc_term_token bg,
-                                 cnc_term_token fg)
-{
-  _ct_render_append_token(buf_ptr, bg);
-  _ct_render_append_token(buf_ptr, fg);
-}
-
 static void _ct_render_color_reset(char **buf_ptr)
 {
   cnc_term_token reset_sequence = ctt_parse_value(KS_RST___);
   _ct_render_append_token(buf_ptr, reset_sequence);
 }
 
-static void _ct_render_data(char **buf_ptr, cnc_buffer *src, size_t start_index,
-                            size_t upper_bound, size_t row_width)
+static void _ct_render_completion(cnc_terminal *ct, char **buf_ptr)
+{
+  ct_completion *cc = &ct->completion;
+  cnc_widget    *cw = ct->focused_widget;
+
+  if (cc->open == false || cw == NULL || cw->type != WIDGET_PROMPT)
+  {
+    return;
+  }
+
+  // a page of matches above the prompt, under the word: only the visible
+  // matches are looked up
+  size_t rows = cc->match.count < CT_COMPLETION_ROWS ? cc->match.count
+                                                     : CT_COMPLETION_ROWS;
+  size_t col = cw->frame.origin.col + PROMPT_PAD + _ct_history_label(ct, cw);
+
+  if (rows > cw->frame.origin.row - 1)
+  {
+    rows = cw->frame.origin.row - 1;
+  }
+
+  if (cc->start > cw->index)
+  {
+    col += cb_data_width(&cw->buffer, cw->index, cc->start - cw->index);
+  }
+
+  if (rows == 0 || col > ct->scr_cols)
+  {
+    return;
+  }
+
+  size_t width = ct->scr_cols + 1 - col;
+  size_t top   = cc->index < cc->match.count ? cc->index / rows * rows : 0;
+
+  if (width > CT_COMPLETION_WIDTH)
+  {
+    width = CT_COMPLETION_WIDTH;
+  }
+
+  for (size_t row = 0; row < rows && top + row < cc->match.count; row++)
+  {
+    char   text[CCP_TEXT_MAX];
+    size_t used = 0;
+
+    memcpy(text, cc->word, cc->word_length);
+    ccp_get(cc->candidates, &cc->match, top + row, text + cc->word_length,
+            sizeof(text) - cc->word_length);
+
+    *buf_ptr += sprintf(*buf_ptr, "\x1b[%zu;%zuH",
+                        cw->frame.origin.row - rows + row, col);
+
+    _ct_render_style(ct, buf_ptr,
+                     top + row == cc->index ? cc->style_alt : cc->style_main);
+
+    for (const char *p = text; *p != '\0';)
+    {
+      cnc_term_token token = {0};
+
+      if (ctt_parse_bytes((uint8_t *)p, &token) == false ||
+          token.token.length == 0 || used + ctt_resolve_width(&token) > width)
+      {
+        break;
+      }
+
+      _ct_render_append_token(buf_ptr, token);
+
+      used += ctt_resolve_width(&token);
+      p += token.token.length;
+    }
+
+    _ct_render_empty_row(buf_ptr, width - used);
+    _ct_render_color_reset(buf_ptr);
+  }
+}
+
+static void _ct_render_cursor(cnc_terminal *ct, char **buf_ptr)
+{
+  _ct_render_str(buf_ptr, ct->mode == MODE_CMD ? STR_CURSOR_CMD
+                                               : STR_CURSOR_INS);
+
+  cnc_widget *cw = ct_focused_widget(ct);
+
+  // the cursor is only shown in the prompt
+  if (cw && cw->type == WIDGET_PROMPT)
+  {
+    cc_set_position(
+      &ct->cursor, cw->frame.origin.row + 1,
+      cw->frame.origin.col + PROMPT_PAD + _ct_history_label(ct, cw) +
+        cb_data_width(&cw->buffer, cw->index, cw->data_index - cw->index));
+
+    *buf_ptr += sprintf(*buf_ptr, "\x1b[%zu;%zuH" STR_CURSOR_SHOW,
+                        ct->cursor.row, ct->cursor.col);
+  }
+}
+
+static void _ct_render_data(cnc_terminal *ct, char **buf_ptr, cnc_buffer *src,
+                            size_t start_index, size_t upper_bound,
+                            size_t row_width)
 {
   /*
    * start_index -> first index of data
@@ -487,16 +1047,39 @@ static void _ct_render_data(char **buf_ptr, cnc_buffer *src, size_t start_index,
 
   size_t width = 0;
 
+  // open the style covering the first token, then switch styles
+  // wherever a span starts within the row
+  const cb_style_span *span = cb_get_style(src, start_index);
+  size_t               next = 0;
+
+  if (span != NULL)
+  {
+    if (span->style != CS_DEFAULT)
+    {
+      _ct_render_style(ct, buf_ptr, span->style);
+    }
+
+    next = span - src->styles + 1;
+  }
+
   for (size_t i = start_index; i <= upper_bound; ++i)
   {
+    // SGR sequences start with a reset: no need to clear the previous one
+    while (next < src->styles_size && src->styles[next].start <= i)
+    {
+      _ct_render_style(ct, buf_ptr, src->styles[next++].style);
+    }
+
     cnc_term_token *t = &src->data[i];
     memcpy(*buf_ptr, t->seq, t->token.length);
     *buf_ptr += t->token.length;
-    width += t->token.width;
+    width += ctt_resolve_width(t);
   }
 
   memset(*buf_ptr, ' ', row_width - width);
   *buf_ptr += (row_width - width);
+
+  _ct_frame_stats(ct)->tokens += upper_bound + 1 - start_index;
 }
 
 static void _ct_render_empty_row(char **buf_ptr, size_t row_width)
@@ -513,6 +1096,361 @@ static void _ct_render_enter(char **buf_ptr)
   (*buf_ptr)++;
 }
 
+static void _ct_render_file(cnc_terminal *ct, cnc_widget *cw, char **buf_ptr)
+{
+  // a file cut while its rows are read faults: they are drawn again from
+  // the size measured then, and left empty if that faults too
+  ct_file_rows rows = {ct, cw, *buf_ptr};
+
+  for (size_t attempt = 0; attempt < 2; attempt++)
+  {
+    rows.buf_ptr = *buf_ptr;
+
+    if (cfv_guard(&cw->file, &cw->top_line, _ct_render_file_rows, &rows))
+    {
+      *buf_ptr = rows.buf_ptr;
+
+      return;
+    }
+  }
+
+  for (size_t row = 0; row < cw->frame.height; row++)
+  {
+    _ct_render_row_start(ct, cw, buf_ptr, row);
+    _ct_render_empty_row(buf_ptr, cw->frame.width);
+  }
+}
+
+static void _ct_render_file_rows(void *context)
+{
+  // rows are decoded from the map as they are drawn: only the pages of the
+  // visible rows are touched, and nothing is kept between frames
+  ct_file_rows  *rows    = context;
+  cnc_terminal  *ct      = rows->ct;
+  cnc_widget    *cw      = rows->cw;
+  char         **buf_ptr = &rows->buf_ptr;
+  cnc_file_view *file    = &cw->file;
+  size_t         width   = cw->frame.width;
+  size_t         row     = 0;
+  size_t         start   = 0;
+
+  cfv_set_width(file, width, &cw->top_line);
+  cw->top_row = 0;
+
+  if (cw->scroll != 0)
+  {
+    cfv_move(file, &cw->top_line, cw->scroll, width);
+    cw->scroll = 0;
+  }
+
+  // the file ends before the bottom of the widget: the rows above fill it
+  for (start = cw->top_line; row < cw->frame.height && start < file->size;
+       row++)
+  {
+    start = cfv_row(file, start, width, NULL);
+  }
+
+  if (row < cw->frame.height)
+  {
+    cfv_move(file, &cw->top_line, (ptrdiff_t)row - (ptrdiff_t)cw->frame.height,
+             width);
+  }
+
+  cw->at_end = start >= file->size;
+  start      = cw->top_line;
+
+  for (row = 0; row < cw->frame.height; row++)
+  {
+    size_t end  = start;
+    size_t next = cfv_row(file, start, width, &end);
+    size_t col  = 0;
+
+    _ct_render_row_start(ct, cw, buf_ptr, row);
+
+    if (cw->style != CS_DEFAULT)
+    {
+      _ct_render_style(ct, buf_ptr, cw->style);
+    }
+
+    for (size_t offset = start; offset < end;)
+    {
+      cnc_term_token token;
+      size_t         cells = 0;
+
+      offset += cfv_token(file, offset, col, &token, &cells);
+
+      if (token.token.value == C_TAB)
+      {
+        _ct_render_empty_row(buf_ptr, cells);
+      }
+
+      else
+      {
+        _ct_render_append_token(buf_ptr, token);
+      }
+
+      col += cells;
+    }
+
+    _ct_render_empty_row(buf_ptr, col < width ? width - col : 0);
+    _ct_render_color_reset(buf_ptr);
+
+    start = next;
+  }
+
+  // the pages scrolled away from leave the process
+  cfv_trim(file, cw->top_line, start);
+}
+
+static void *_ct_render_main(void *arg)
+{
+  cnc_terminal *ct = arg;
+
+  pthread_mutex_lock(&ct->render_lock);
+
+  for (;;)
+  {
+    while (ct->render_ready == false && ct->render_busy == false &&
+           ct->render_running)
+    {
+      pthread_cond_wait(&ct->render_cond, &ct->render_lock);
+    }
+
+    // stopped, and the last frame was written
+    if (ct->render_ready == false && ct->render_busy == false)
+    {
+      break;
+    }
+
+    // take the newest frame, the mailbox gets the one taken before it.
+    // a frame equal to the one on screen is not written again
+    bool take = ct->render_ready;
+    bool same = take && ct->render_frame.size == ct->render_front.size &&
+                memcmp(ct->render_frame.bytes, ct->render_front.bytes,
+                       ct->render_frame.size) == 0;
+
+    if (take)
+    {
+      ct_frame frame   = ct->render_front;
+      ct->render_front = ct->render_frame;
+      ct->render_frame = frame;
+      ct->render_ready = false;
+    }
+
+    ct->render_busy = true;
+
+    pthread_mutex_unlock(&ct->render_lock);
+    CTR_BEGIN("write");
+
+    if (take && same == false)
+    {
+      co_submit(&ct->output, ct->render_front.bytes, ct->render_front.size);
+    }
+
+    // a full terminal: wait for room, newer frames replace the waiting one
+    if (co_flush(&ct->output) == false)
+    {
+      co_wait(&ct->output, CT_OUTPUT_WAIT_MS);
+    }
+
+    CTR_END("write");
+    pthread_mutex_lock(&ct->render_lock);
+
+    ct->render_busy   = co_pending(&ct->output);
+    ct->render_output = (cal_usage){0};
+    co_usage(&ct->output, &ct->render_output);
+    pthread_cond_broadcast(&ct->render_cond);
+  }
+
+  pthread_mutex_unlock(&ct->render_lock);
+
+  return NULL;
+}
+
+static void _ct_render_publish(cnc_terminal *ct)
+{
+  // swap the screenbuffer with the mailbox: the UI thread never waits for
+  // a write, and an unwritten frame is dropped for the new one
+  pthread_mutex_lock(&ct->render_lock);
+
+  ct_frame frame = ct->render_frame;
+
+  ct->render_frame.bytes    = ct->screenbuffer;
+  ct->render_frame.size     = ct->frame_size;
+  ct->render_frame.capacity = ct->screenbuffer_size;
+
+  ct->screenbuffer      = frame.bytes;
+  ct->screenbuffer_size = frame.capacity;
+  ct->frame_size        = 0;
+  ct->render_ready      = true;
+
+  pthread_cond_broadcast(&ct->render_cond);
+  pthread_mutex_unlock(&ct->render_lock);
+}
+
+static void _ct_render_row_start(cnc_terminal *ct, cnc_widget *cw,
+                                 char **buf_ptr, size_t row)
+{
+  // the first row of a widget is placed at its frame. rows of a full width
+  // widget follow each other, the rows of a narrower one are placed too
+  bool full = cw->frame.origin.col == 1 && cw->frame.width == ct->scr_cols;
+
+  if (row > 0 && full)
+  {
+    _ct_render_enter(buf_ptr);
+
+    return;
+  }
+
+  *buf_ptr += sprintf(*buf_ptr, "\x1b[%zu;%zuH", cw->frame.origin.row + row,
+                      cw->frame.origin.col);
+}
+
+static void _ct_render_stats(cnc_terminal *ct, char **buf_ptr,
+                             size_t row_width)
+{
+  // mean of the last frames, in place of the info bar text
+  ct_stats_summary summary;
+  char             text[256] = "";
+
+  if (ct_frame_stats_summary(ct, &summary))
+  {
+    ct_frame_stats *mean = &summary.mean;
+
+    snprintf(text, sizeof(text),
+             " layout %.3f render %.3f write %.3f ms | rows %zu tokens %zu"
+             " bytes %zu syscalls %zu",
+             mean->layout_ns / 1e6, mean->render_ns / 1e6,
+             mean->write_ns / 1e6, mean->rows_wrapped, mean->tokens,
+             mean->bytes, mean->syscalls);
+  }
+
+  size_t length = strlen(text);
+
+  if (length > row_width)
+  {
+    length = row_width;
+  }
+
+  memcpy(*buf_ptr, text, length);
+  *buf_ptr += length;
+
+  _ct_render_empty_row(buf_ptr, row_width - length);
+}
+
+static void _ct_render_str(char **buf_ptr, const char *str)
+{
+  size_t length = strlen(str);
+
+  memcpy(*buf_ptr, str, length);
+  *buf_ptr += length;
+}
+
+static void _ct_render_style(cnc_terminal *ct, char **buf_ptr,
+                             cnc_style style)
+{
+  const cs_sgr_entry *sgr = cs_sgr_lookup(&ct->sgr_cache, style);
+
+  memcpy(*buf_ptr, sgr->bytes, sgr->length);
+  *buf_ptr += sgr->length;
+}
+
+static void _ct_render_sync(cnc_terminal *ct)
+{
+  if (ct->render_running == false)
+  {
+    return;
+  }
+
+  // wait until every published frame is on the screen. the screen is
+  // changed by the caller, so the next frame is written even if it matches
+  pthread_mutex_lock(&ct->render_lock);
+
+  while (ct->render_ready || ct->render_busy)
+  {
+    pthread_cond_wait(&ct->render_cond, &ct->render_lock);
+  }
+
+  ct->render_front.size = 0;
+
+  pthread_mutex_unlock(&ct->render_lock);
+}
+
+static bool _ct_reserve_bytes(cnc_terminal *ct, char **buf_ptr,
+                              char **rendered, size_t length)
+{
+  // length bytes are about to be written at *buf_ptr, on top of what is
+  // left for a whole frame. the buffer may move: both pointers follow it
+  size_t used  = *buf_ptr - ct->screenbuffer;
+  size_t since = *buf_ptr - *rendered;
+  size_t size  = used + _ct_screenbuffer_size(ct) + length;
+
+  if (ct->screenbuffer_size >= size)
+  {
+    return true;
+  }
+
+  char *new_buffer = cal_realloc(&ct->allocator, ct->screenbuffer, size);
+
+  if (new_buffer == NULL)
+  {
+    return false;
+  }
+
+  ct->screenbuffer      = new_buffer;
+  ct->screenbuffer_size = size;
+
+  *buf_ptr  = new_buffer + used;
+  *rendered = *buf_ptr - since;
+
+  return true;
+}
+
+static bool _ct_reserve_screenbuffer(cnc_terminal *ct)
+{
+  size_t size = _ct_screenbuffer_size(ct);
+
+  // buffers coming back from the render thread may be from an older size
+  if (ct->screenbuffer != NULL && ct->screenbuffer_size >= size)
+  {
+    return true;
+  }
+
+  char *new_buffer = cal_realloc(&ct->allocator, ct->screenbuffer, size);
+
+  if (new_buffer == NULL)
+  {
+    return false;
+  }
+
+  ct->screenbuffer      = new_buffer;
+  ct->screenbuffer_size = size;
+
+  return true;
+}
+
+static bool _ct_reserve_text(cnc_terminal *ct, char **buf_ptr, char **rendered,
+                             cnc_buffer *cb, size_t start, size_t end)
+{
+  // the tokens [start, end) are about to be drawn: on top of what is left
+  // for a whole frame, room for their bytes (zero width characters stack
+  // up in a cell) and one SGR sequence for each span starting among them
+  if (end <= start)
+  {
+    return true;
+  }
+
+  const cb_style_span *first = cb_get_style(cb, start);
+  const cb_style_span *last  = cb_get_style(cb, end - 1);
+
+  size_t spans = (last != NULL ? (size_t)(last - cb->styles) + 1 : 0) -
+                 (first != NULL ? (size_t)(first - cb->styles) + 1 : 0);
+
+  return _ct_reserve_bytes(ct, buf_ptr, rendered,
+                           spans * CS_SGR_MAX +
+                             cb_data_length(cb, start, end - start));
+}
+
 static void _ct_restore(cnc_terminal *ct)
 {
   if (ct == NULL)
@@ -520,22 +1458,80 @@ static void _ct_restore(cnc_terminal *ct)
     return;
   }
 
-  tcsetattr(STDIN_FILENO, TCSAFLUSH, &ct->orig_term);
+  // frames still queued would land after the restore
+  _ct_render_sync(ct);
+  co_drain(&ct->output);
+
+  ct->backend.leave(ct->backend.context);
   ct->in_raw_mode = false;
+}
+
+static size_t _ct_screenbuffer_size(cnc_terminal *ct)
+{
+  // number of bytes in a frame:
+  //  - every cell of the screen: CT_CELL_BYTES
+  //  - every row of a widget (side by side widgets share screen rows):
+  //    CT_ROW_BYTES
+  // plus the frame prefix and the cursor: CT_FRAME_BYTES, and the rows of
+  // the completion list drawn over the widgets
+  size_t rows = 0;
+
+  for (size_t i = 0; i < ct->widgets_count; i++)
+  {
+    if (ct->widgets[i] != NULL)
+    {
+      rows += ct->widgets[i]->frame.height;
+    }
+  }
+
+  return 1 + CT_FRAME_BYTES + ct->scr_cols * ct->scr_rows * CT_CELL_BYTES +
+         rows * CT_ROW_BYTES +
+         (CT_COMPLETION_WIDTH * CT_CELL_BYTES + CT_ROW_BYTES) *
+           CT_COMPLETION_ROWS;
+}
+
+static void _ct_scroll(cnc_widget *cw, ptrdiff_t rows)
+{
+  // the anchor moves at the next layout, only the rows walked are wrapped
+  cw->scroll += rows;
+}
+
+static bool _ct_search_first(cnc_terminal *ct, cnc_widget *cw)
+{
+  // search forward from the first visible row
+  size_t  from = cw->buffer.dropped;
+  cwc_row row;
+
+  if (cwc_wrap(&cw->wrap, &cw->buffer, cw->top_line, cw->top_row, &row, 1) >
+      0)
+  {
+    from = row.start;
+  }
+
+  return _ct_search_jump(ct, cw, from);
+}
 
-  // Restore cursor
-  _ct_c_cursor_ins();
-  _ct_c_show_cursor();
+static bool _ct_search_jump(cnc_terminal *ct, cnc_widget *cw, size_t from)
+{
+  size_t hit;
 
-  // Restore color
-  if (write(STDOUT_FILENO, STR_RESET_STYLES, 5) == -1)
+  if (csi_find(&cw->search, &cw->buffer, &ct->search_pattern, from, &hit) ==
+      false)
   {
+    return false;
   }
 
-  // Clear screen
-  _ct_c_clrscr();
-  _ct_c_home_position();
-  fflush(stdout);
+  ct->search_hit = hit;
+
+  // anchor the view on the row of the hit, the layout keeps it full
+  cwc_sync(&cw->wrap, &cw->buffer);
+
+  cw->top_line = cwc_find_line(&cw->wrap, hit);
+  cw->top_row  = cwc_find_row(&cw->wrap, &cw->buffer, cw->top_line, hit);
+  cw->scroll   = 0;
+  cw->at_end   = false;
+
+  return true;
 }
 
 static void _ct_set_mode_cmd(cnc_terminal *ct)
@@ -579,33 +1575,34 @@ static bool _ct_set_raw_mode(cnc_terminal *ct)
     return false;
   }
 
-  _ct_c_clrscr();
-  _ct_c_home_position();
-
-  // read the current terminal attributes and store them
-  if (tcgetattr(STDIN_FILENO, &ct->orig_term) == -1)
+  // raw mode, and frames are written without blocking from here on
+  if (ct->backend.enter(ct->backend.context) == false)
   {
     return false;
   }
 
-  // put the terminal in raw mode
-  struct termios raw_term = ct->orig_term;
+  ct->in_raw_mode = true;
+
+  return true;
+}
 
-  raw_term.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
-  raw_term.c_oflag &= ~(OPOST);
-  raw_term.c_cflag |= (CS8);
-  raw_term.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
-  raw_term.c_cc[VMIN]  = 1;
-  raw_term.c_cc[VTIME] = 0;
+static cnc_widget *_ct_target_display(cnc_terminal *ct)
+{
+  cnc_widget *fw = ct->focused_widget;
+  cnc_widget *dw = ct->main_display_widget;
 
-  if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw_term) == -1)
+  // file widgets scroll with the same keys
+  if (fw && (fw->type == WIDGET_DISPLAY || fw->type == WIDGET_FILE))
   {
-    return false;
+    return fw;
   }
 
-  ct->in_raw_mode = true;
+  if (dw && (dw->type == WIDGET_DISPLAY || dw->type == WIDGET_FILE))
+  {
+    return dw;
+  }
 
-  return true;
+  return NULL;
 }
 
 static void _ct_vm_0(cnc_terminal *ct)
@@ -630,12 +1627,22 @@ static void _ct_vm_0(cnc_terminal *ct)
     return;
   }
 
-  if (fw->type == WIDGET_DISPLAY)
+  // newest text: the anchor on the last row, the layout fills up from it.
+  // nothing moves when the last row is on screen already
+  if (fw->type == WIDGET_DISPLAY && (fw->at_end == false || fw->scroll != 0))
   {
-    if (fw->data_index > fw->frame.height)
+    cnc_wrap_cache *wrap = &fw->wrap;
+
+    cwc_sync(wrap, &fw->buffer);
+
+    if (wrap->size > 0)
     {
-      fw->index = fw->data_index - fw->frame.height;
+      fw->top_line = wrap->base + wrap->size - 1;
+      fw->top_row  = cwc_line_rows(wrap, &fw->buffer, fw->top_line) - 1;
     }
+
+    fw->scroll = 0;
+    fw->at_end = true;
   }
 }
 
@@ -670,9 +1677,15 @@ static void _ct_vm_$(cnc_terminal *ct)
     return;
   }
 
+  // oldest text kept: the first row of the first line
   if (fw->type == WIDGET_DISPLAY)
   {
-    fw->index = 0;
+    cwc_sync(&fw->wrap, &fw->buffer);
+
+    fw->top_line = fw->wrap.base;
+    fw->top_row  = 0;
+    fw->scroll   = 0;
+    fw->at_end   = false;
   }
 }
 
@@ -828,24 +1841,30 @@ static void _ct_vm_j(cnc_terminal *ct)
     return;
   }
 
-  cnc_widget *fw = ct->focused_widget;
-  cnc_widget *dw = ct->main_display_widget;
+  cnc_widget *cw = _ct_target_display(ct);
+
+  if (cw)
+  {
+    _ct_scroll(cw, 1);
+  }
+}
 
-  if (fw && fw->type == WIDGET_DISPLAY &&
-      fw->index + fw->frame.height < fw->data_index)
+static void _ct_vm_k(cnc_terminal *ct)
+{
+  if (ct == NULL)
   {
-    fw->index++;
     return;
   }
 
-  if (dw && dw->type == WIDGET_DISPLAY &&
-      dw->index + dw->frame.height < dw->data_index)
+  cnc_widget *cw = _ct_target_display(ct);
+
+  if (cw)
   {
-    dw->index++;
+    _ct_scroll(cw, -1);
   }
 }
 
-static void _ct_vm_k(cnc_terminal *ct)
+static void _ct_vm_l(cnc_terminal *ct)
 {
   if (ct == NULL)
   {
@@ -853,44 +1872,67 @@ static void _ct_vm_k(cnc_terminal *ct)
   }
 
   cnc_widget *fw = ct->focused_widget;
-  cnc_widget *dw = ct->main_display_widget;
 
-  if (fw && fw->type == WIDGET_DISPLAY && fw->index > 0)
+  if (fw == NULL || fw->type != WIDGET_PROMPT)
   {
-    fw->index--;
-
     return;
   }
 
-  if (dw && dw->type == WIDGET_DISPLAY && dw->index > 0)
+  if (fw->data_index < fw->buffer.size)
   {
-    dw->index--;
+    fw->data_index++;
+
+    if (fw->data_index - fw->index > fw->frame.width - PROMPT_PAD - 1)
+    {
+      fw->index++;
+    }
+  }
+}
 
+static void _ct_vm_n(cnc_terminal *ct)
+{
+  if (ct == NULL)
+  {
     return;
   }
+
+  ct_search_next(ct, _ct_target_display(ct));
 }
 
-static void _ct_vm_l(cnc_terminal *ct)
+static void _ct_vm_slash(cnc_terminal *ct)
 {
   if (ct == NULL)
   {
     return;
   }
 
-  cnc_widget *fw = ct->focused_widget;
+  cnc_widget *dw = _ct_target_display(ct);
 
-  if (fw == NULL || fw->type != WIDGET_PROMPT)
+  // file text is not indexed for search
+  if (dw == NULL || dw->type != WIDGET_DISPLAY)
   {
     return;
   }
 
-  if (fw->data_index < fw->buffer.size)
+  // the prompt text is the pattern
+  for (size_t i = 0; i < ct->widgets_count; i++)
   {
-    fw->data_index++;
+    cnc_buffer *prompt = &ct->widgets[i]->buffer;
 
-    if (fw->data_index - fw->index > fw->frame.width - PROMPT_PAD - 1)
+    if (ct->widgets[i]->type == WIDGET_PROMPT)
     {
-      fw->index++;
+      // a pattern as long as the prompt can hold
+      if (ct->search_pattern.max_capacity < prompt->max_capacity)
+      {
+        cb_set_max_capacity(&ct->search_pattern, prompt->max_capacity);
+      }
+
+      if (cb_set_buf(&ct->search_pattern, prompt))
+      {
+        _ct_search_first(ct, dw);
+      }
+
+      return;
     }
   }
 }
@@ -917,27 +1959,37 @@ static void _ct_vm_x(cnc_terminal *ct)
 
 // main functions
 cnc_widget *ct_add_widget(cnc_terminal *ct, cw_type type)
+{
+  return ct_add_widget_with_capacity(ct, type, 0);
+}
+
+cnc_widget *ct_add_widget_with_capacity(cnc_terminal *ct, cw_type type,
+                                        size_t capacity)
 {
   if (ct == NULL)
   {
     return NULL;
   }
 
-  cnc_widget *cw = cw_init(type);
+  // capacity 0: the default of the widget type
+  cnc_widget *cw = cw_init(type, capacity, &ct->allocator);
 
   if (cw == NULL)
   {
     return NULL;
   }
 
-  size_t height = 0;
+  // the smallest heights ct_setup_widgets accepts, frames are set later
+  size_t height = type == WIDGET_DISPLAY || type == WIDGET_FILE ? 3 : 2;
 
   for (size_t i = 0; i < ct->widgets_count; i++)
   {
-    height += ct->widgets[i]->frame.height;
+    cw_type other = ct->widgets[i]->type;
+
+    height += other == WIDGET_DISPLAY || other == WIDGET_FILE ? 3 : 2;
   }
 
-  if (cw->frame.height + height > ct->scr_rows)
+  if (height > ct->scr_rows)
   {
     cw_destroy(&cw);
 
@@ -948,7 +2000,8 @@ cnc_widget *ct_add_widget(cnc_terminal *ct, cw_type type)
   if (ct->widgets_count > 0)
   {
     cnc_widget **new_ct_widgets =
-      realloc(ct->widgets, (ct->widgets_count + 1) * sizeof(*ct->widgets));
+      cal_realloc(&ct->arena_allocator, ct->widgets,
+                  (ct->widgets_count + 1) * sizeof(*ct->widgets));
 
     if (new_ct_widgets == NULL)
     {
@@ -978,32 +2031,7 @@ void ct_check_for_resize(cnc_terminal *ct)
   {
     resize_flag = 0;
 
-    if (ct_get_size(ct) == false)
-    {
-      return;
-    }
-
-    _ct_c_clrscr();
-    _ct_c_home_position();
-
-    size_t new_buffer_size = 1 + (ct->scr_cols + 16) * ct->scr_rows * 4;
-    char  *new_buffer      = realloc(ct->screenbuffer, new_buffer_size);
-
-    if (new_buffer == NULL)
-    {
-      ct_destroy(ct);
-    }
-
-    ct->screenbuffer      = new_buffer;
-    ct->screenbuffer_size = new_buffer_size;
-
-    memset(ct->screenbuffer, 0, ct->screenbuffer_size);
-
-    cc_setup(&ct->cursor, ct->scr_rows, ct->scr_cols);
-
-    ct_screenbuffer_reset(ct);
-    ct_setup_widgets(ct);
-    ct_update(ct);
+    ct_resize(ct);
   }
 }
 
@@ -1014,23 +2042,31 @@ void ct_destroy(cnc_terminal *ct)
     return;
   }
 
+  // write the last frame before restoring the terminal
+  ct_render_thread_stop(ct);
+
   // restore terminal
   if (ct->in_raw_mode)
   {
     _ct_restore(ct);
   }
 
-  // destroy rows info
-  if (ct->rows_info)
+  co_destroy(&ct->output);
+
+  cb_destroy(&ct->search_pattern);
+  cb_destroy(&ct->history_line);
+  cb_destroy(&ct->history_query);
+
+  // the history is set up after the search pattern
+  if (ct->history.bytes != NULL)
   {
-    free(ct->rows_info);
-    ct->rows_info = NULL;
+    ch_destroy(&ct->history);
   }
 
   // destroy screenbuffer
   if (ct->screenbuffer)
   {
-    free(ct->screenbuffer);
+    cal_free(&ct->allocator, ct->screenbuffer);
     ct->screenbuffer = NULL;
   }
 
@@ -1043,11 +2079,15 @@ void ct_destroy(cnc_terminal *ct)
     }
   }
 
-  free(ct->widgets);
+  cal_free(&ct->arena_allocator, ct->widgets);
   ct->widgets = NULL;
 
-  free(ct);
-  ct = NULL;
+  cl_destroy(ct->layout);
+  ct->layout = NULL;
+
+  // the terminal itself lives in the arena
+  cnc_arena arena = ct->arena;
+  cal_arena_destroy(&arena);
 }
 
 void ct_focus_next(cnc_terminal *ct)
@@ -1108,6 +2148,51 @@ void ct_focus_widget(cnc_terminal *ct, cnc_widget *cw)
 
   cw->has_focus      = true;
   ct->focused_widget = cw;
+
+  // colors follow the focus, the info bar's too
+  _ct_mark_dirty(ct, CW_DIRTY_FOCUS);
+}
+
+const ct_frame_stats *ct_frame_stats_last(const cnc_terminal *ct)
+{
+  if (ct == NULL || ct->stats_count == 0)
+  {
+    return NULL;
+  }
+
+  return &ct->stats[(ct->stats_count - 1) % CT_STATS_WINDOW];
+}
+
+bool ct_frame_stats_summary(const cnc_terminal *ct, ct_stats_summary *summary)
+{
+  if (ct == NULL || summary == NULL || ct->stats_count == 0)
+  {
+    return false;
+  }
+
+  memset(summary, 0, sizeof(*summary));
+
+  summary->frames = ct->stats_count < CT_STATS_WINDOW ? ct->stats_count
+                                                      : CT_STATS_WINDOW;
+
+  ct_frame_stats *mean = &summary->mean;
+  ct_frame_stats *max  = &summary->max;
+
+  // sums first, divided once at the end
+  for (size_t i = 0; i < summary->frames; i++)
+  {
+    _ct_frame_stats_add(mean, max, &ct->stats[i]);
+  }
+
+  mean->layout_ns /= summary->frames;
+  mean->render_ns /= summary->frames;
+  mean->write_ns /= summary->frames;
+  mean->rows_wrapped /= summary->frames;
+  mean->tokens /= summary->frames;
+  mean->bytes /= summary->frames;
+  mean->syscalls /= summary->frames;
+
+  return true;
 }
 
 cnc_widget *ct_focused_widget(cnc_terminal *ct)
@@ -1133,18 +2218,8 @@ bool ct_get_size(cnc_terminal *ct)
     return false;
   }
 
-  struct winsize ws;
-
-  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0 ||
-      ws.ws_row == 0)
-  {
-    return false;
-  }
-
-  ct->scr_rows = ws.ws_row;
-  ct->scr_cols = ws.ws_col;
-
-  return true;
+  return ct->backend.get_size(ct->backend.context, &ct->scr_rows,
+                              &ct->scr_cols);
 }
 
 static void _ct_delete_char(cnc_terminal *ct)
@@ -1190,38 +2265,9 @@ int ct_get_user_input(cnc_terminal *ct)
     return 0;
   }
 
-  cnc_widget    *fw         = ct->focused_widget;
   int            result     = 0;
   cnc_term_token ctt_result = {0};
 
-  // build the commands map
-  CommandMap commands[] = {
-    {C_BCK,         _ct_delete_char },
-    {KS_ARR_UP,     _ct_vm_k        },
-    {'k',           _ct_vm_k        },
-    {KS_ARR_DN,     _ct_vm_j        },
-    {'j',           _ct_vm_j        },
-    {KS_ARR_RT,     _ct_vm_l        },
-    {'l',           _ct_vm_l        },
-    {KS_ARR_LT,     _ct_vm_h        },
-    {'h',           _ct_vm_h        },
-    {'e',           _ct_vm_e        },
-    {'b',           _ct_vm_b        },
-    {KS_PAG_UP,     _ct_page_up     },
-    {KS_PAG_DN,     _ct_page_dn     },
-    {C_ESC,         _ct_set_mode_cmd},
-    {CTRL_KEY('c'), _ct_set_mode_cmd},
-    {KS_INS___,     _ct_set_mode_ins},
-    {'i',           _ct_set_mode_ins},
-    {C_TAB,         ct_focus_next   },
-    {'a',           _ct_vm_a        },
-    {'A',           _ct_vm_aa       },
-    {'0',           _ct_vm_0        },
-    {'$',           _ct_vm_$        },
-    {'x',           _ct_vm_x        },
-    {'\0',          NULL            }  // end of map array
-  };
-
   while (result == 0)
   {
     ctt_result = _ct_getch(ct);
@@ -1236,65 +2282,79 @@ int ct_get_user_input(cnc_terminal *ct)
     _ct_check_for_suspend(ct);
     ct_check_for_resize(ct);
 
-    usleep(10000);
-  }
-
-  // only when prompt has focus
-  if (ct->mode == MODE_INS && fw && fw->type == WIDGET_PROMPT)
-  {
-    // user presses ENTER key on a WIDGET_PROMPT
-    if (result == C_ENT || result == C_RET)
+    // show text posted by other threads while waiting for a key
+    if (result == 0 && _ct_drain_posts(ct))
     {
-      result = C_ENT;
-
-      return result;
+      ct_update(ct);
     }
 
-    // result is a valid character
-    if (result >= C_SPC && result <= C_TLD)
-    {
-      if (fw->buffer.size < fw->buffer.max_capacity)
-      {
-        _ct_insert_char(fw, result);
-      }
-
-      return result;
-    }
+    // bytes the terminal could not take yet
+    _ct_flush_output(ct);
 
-    // ctt_result is UTF8
-    if (ctt_result.token.type == CTT_UTF8)
+    if (result == 0)
     {
-      if (fw->buffer.size < fw->buffer.max_capacity)
-      {
-        _ct_insert_token(fw, ctt_result);
-      }
-
-      return ctt_result.token.value;
+      usleep(10000);
     }
   }
 
-  for (size_t i = 0; commands[i].key != 0; i++)
-  {
-    if (commands[i].key == result)
-    {
-      commands[i].func(ct);
-
-      return result;
-    }
-  }
+  CTR_BEGIN("key dispatch");
+  result = _ct_dispatch(ct, ctt_result);
+  CTR_END("key dispatch");
 
   return result;
 }
 
 cnc_terminal *ct_init(size_t min_height, size_t min_width)
 {
-  cnc_terminal *ct = malloc(sizeof(*ct));
+  return ct_init_with_allocator(min_height, min_width, NULL);
+}
+
+cnc_terminal *ct_init_with_allocator(size_t min_height, size_t min_width,
+                                     const cnc_allocator *allocator)
+{
+  cnc_backend tty = cbe_tty();
+
+  return ct_init_with_backend(min_height, min_width, allocator, &tty);
+}
+
+cnc_terminal *ct_init_with_backend(size_t min_height, size_t min_width,
+                                   const cnc_allocator *allocator,
+                                   const cnc_backend   *backend)
+{
+  if (backend == NULL)
+  {
+    return NULL;
+  }
+
+  // the terminal and everything that lives as long as it (widgets array,
+  // rows info) come from an arena, so startup needs few allocations
+  cnc_arena arena;
+
+  if (cal_arena_init(&arena, allocator, CT_ARENA_BLOCK_SIZE) == false)
+  {
+    return NULL;
+  }
+
+  cnc_allocator arena_allocator = cal_arena_allocator(&arena);
+  cnc_terminal *ct              = cal_alloc(&arena_allocator, sizeof(*ct));
 
   if (ct == NULL)
   {
+    cal_arena_destroy(&arena);
+
     return NULL;
   }
 
+  memset(ct, 0, sizeof(*ct));
+
+  ct->allocator       = allocator == NULL ? *cal_default() : *allocator;
+  ct->arena           = arena;
+  ct->arena_allocator = cal_arena_allocator(&ct->arena);
+
+  ct->backend = *backend;
+
+  co_init(&ct->output, &ct->allocator, &ct->backend);
+
   // Setup the SIGTSTP signal handler
   ct->sa_sigtstp.sa_handler = __handle__sigtstp;
   ct->sa_sigtstp.sa_flags   = SA_RESTART;
@@ -1331,7 +2391,7 @@ cnc_terminal *ct_init(size_t min_height, size_t min_width)
   ct->widgets_count    = 0;
 
   // Allocate memory for widgets
-  ct->widgets = malloc(sizeof(*ct->widgets));
+  ct->widgets = cal_alloc(&ct->arena_allocator, sizeof(*ct->widgets));
 
   if (ct->widgets == NULL)
   {
@@ -1343,6 +2403,37 @@ cnc_terminal *ct_init(size_t min_height, size_t min_width)
   // no widget has focus at the beginning
   ct->focused_widget = NULL;
 
+  // no search pattern at the beginning
+  ct->search_hit = 0;
+
+  if (cb_init_with_allocator(&ct->search_pattern, PROMPT_BUFFER_SIZE,
+                             &ct->allocator) == false)
+  {
+    ct_destroy(ct);
+
+    return NULL;
+  }
+
+  // no completion until the app gives candidates
+  ct->completion.candidates = NULL;
+  ct->completion.open       = false;
+  ct->completion.style_main = CS_STYLE(CS_BLACK, CS_WHITE, 0);
+  ct->completion.style_alt  = CS_STYLE(CS_BLACK, CS_CYAN, 0);
+
+  // empty prompt history, in memory until ch_load gives it a file
+  ct->history_search = false;
+
+  if (ch_init(&ct->history, 0, 0, &ct->allocator) == false ||
+      cb_init_with_allocator(&ct->history_line, PROMPT_BUFFER_SIZE,
+                             &ct->allocator) == false ||
+      cb_init_with_allocator(&ct->history_query, CH_QUERY_SIZE,
+                             &ct->allocator) == false)
+  {
+    ct_destroy(ct);
+
+    return NULL;
+  }
+
   // no main display widget at the beginning
   // set this in the app to allow scroll from within the prompt
   ct->main_display_widget = NULL;
@@ -1365,22 +2456,8 @@ cnc_terminal *ct_init(size_t min_height, size_t min_width)
   // setup cursor data
   cc_setup(&ct->cursor, ct->scr_rows, ct->scr_cols);
 
-  // ct->screenbuffer memory allocation:
-  // number of rows: t->scr_rows.
-  // number of cols: t->scr_cols.
-  // number of bytes in each row:
-  //  - color bg      : 5
-  //  - color fg      : 5
-  //  - total cols    : t->scr_cols
-  //  - color reset   : 4
-  //  - '\n\r'        : 2
-  //
-  // Total bytes in each line: t->scr_cols + 16
-
-  ct->screenbuffer_size = 1 + (ct->scr_cols + 16) * ct->scr_rows * 4;
-  ct->screenbuffer      = malloc(ct->screenbuffer_size);
-
-  if (ct->screenbuffer == NULL)
+  // ct->screenbuffer memory allocation
+  if (_ct_reserve_screenbuffer(ct) == false)
   {
     ct_destroy(ct);
 
@@ -1389,29 +2466,101 @@ cnc_terminal *ct_init(size_t min_height, size_t min_width)
 
   memset(ct->screenbuffer, 0, ct->screenbuffer_size);
 
-  // allocate memory for display rows info
-  // if all the elements of a display would be '\n', we would have a max of
-  // DISPLAY_BUFFER_SIZE rows to save info for the lifetime of the program
+  // put terminal in command mode
+  ct_set_mode(ct, MODE_CMD);
+
+  // empty the buffer and redraw (clear the screen)
+  ct_screenbuffer_reset(ct);
+  _ct_redraw(ct);
 
-  ct->rows_info = malloc(DISPLAY_BUFFER_SIZE * sizeof(*ct->rows_info));
+  return ct;
+}
 
-  if (ct->rows_info == NULL)
+void ct_memory_usage(cnc_terminal *ct, ct_memory *memory)
+{
+  if (memory == NULL)
   {
-    ct_destroy(ct);
+    return;
+  }
 
-    return NULL;
+  memset(memory, 0, sizeof(*memory));
+
+  if (ct == NULL)
+  {
+    return;
   }
 
-  memset(ct->rows_info, 0, DISPLAY_BUFFER_SIZE * sizeof(*ct->rows_info));
+  cal_usage *usage = memory->components;
 
-  // put terminal in command mode
-  ct_set_mode(ct, MODE_CMD);
+  cal_arena_usage(&ct->arena, &usage[CT_MEMORY_TERMINAL]);
 
-  // empty the buffer and redraw (clear the screen)
-  ct_screenbuffer_reset(ct);
-  _ct_redraw(ct);
+  // frames change hands with the render thread under its lock
+  if (ct->render_running)
+  {
+    pthread_mutex_lock(&ct->render_lock);
+  }
+
+  usage[CT_MEMORY_SCREEN].used += ct->frame_size + ct->render_frame.size +
+                                  ct->render_front.size;
+  usage[CT_MEMORY_SCREEN].reserved += ct->screenbuffer_size +
+                                      ct->render_frame.capacity +
+                                      ct->render_front.capacity;
+
+  if (ct->render_running)
+  {
+    usage[CT_MEMORY_OUTPUT].used += ct->render_output.used;
+    usage[CT_MEMORY_OUTPUT].reserved += ct->render_output.reserved;
+
+    pthread_mutex_unlock(&ct->render_lock);
+  }
+
+  else
+  {
+    co_usage(&ct->output, &usage[CT_MEMORY_OUTPUT]);
+  }
+
+  cb_usage(&ct->search_pattern, &usage[CT_MEMORY_TEXT]);
+  cb_usage(&ct->history_line, &usage[CT_MEMORY_TEXT]);
+  cb_usage(&ct->history_query, &usage[CT_MEMORY_TEXT]);
+  ch_usage(&ct->history, &usage[CT_MEMORY_TEXT]);
+
+  for (size_t i = 0; i < ct->widgets_count; i++)
+  {
+    cnc_widget *cw   = ct->widgets[i];
+    size_t      rows = cw->rows_capacity * sizeof(*cw->rows);
+
+    usage[CT_MEMORY_TERMINAL].used += sizeof(*cw);
+    usage[CT_MEMORY_TERMINAL].reserved += sizeof(*cw);
+
+    cb_usage(&cw->buffer, &usage[CT_MEMORY_TEXT]);
+    cwc_usage(&cw->wrap, &usage[CT_MEMORY_LAYOUT]);
+    cfv_usage(&cw->file, &usage[CT_MEMORY_LAYOUT]);
+    csi_usage(&cw->search, &usage[CT_MEMORY_SEARCH]);
+
+    usage[CT_MEMORY_LAYOUT].used += rows;
+    usage[CT_MEMORY_LAYOUT].reserved += rows;
+
+    usage[CT_MEMORY_SCREEN].used += cw->drawn.size;
+    usage[CT_MEMORY_SCREEN].reserved += cw->drawn.capacity;
+  }
+
+  for (size_t i = 0; i < CT_MEMORY_COUNT; i++)
+  {
+    memory->total.used += usage[i].used;
+    memory->total.reserved += usage[i].reserved;
+  }
+}
+
+bool ct_post_text(cnc_widget *cw, const char *bytes, size_t length)
+{
+  if (cw == NULL)
+  {
+    return false;
+  }
 
-  return ct;
+  // safe from any thread: the text is copied and queued, never waits on
+  // the UI thread
+  return cq_push(&cw->posts, bytes, length);
 }
 
 void ct_screenbuffer_reset(cnc_terminal *ct)
@@ -1449,6 +2598,48 @@ void ct_screenbuffer_reset(cnc_terminal *ct)
   */
 }
 
+void ct_set_completion(cnc_terminal *ct, cnc_completion *candidates)
+{
+  if (ct == NULL)
+  {
+    return;
+  }
+
+  // the app keeps the candidates, and may change them between keys
+  ct->completion.candidates = candidates;
+  ct->completion.open       = false;
+}
+
+bool ct_set_layout(cnc_terminal *ct, cnc_layout *layout)
+{
+  if (ct == NULL)
+  {
+    return false;
+  }
+
+  // the terminal owns the tree from now on, NULL stacks the widgets again
+  if (ct->layout != layout)
+  {
+    cl_destroy(ct->layout);
+    ct->layout = layout;
+  }
+
+  return ct_setup_widgets(ct);
+}
+
+bool ct_set_memory_budget(cnc_terminal *ct, size_t budget)
+{
+  if (ct == NULL)
+  {
+    return false;
+  }
+
+  // enforced now, then at every frame
+  ct->memory_budget = budget;
+
+  return _ct_memory_enforce(ct);
+}
+
 void ct_set_mode(cnc_terminal *ct, ct_mode mode)
 {
   if (ct == NULL)
@@ -1461,17 +2652,135 @@ void ct_set_mode(cnc_terminal *ct, ct_mode mode)
     return;
   }
 
-  if (mode == MODE_CMD)
+  // the cursor shape and the prompt symbol change with the next frame
+  ct->mode = mode;
+
+  _ct_mark_dirty(ct, CW_DIRTY_FOCUS);
+}
+
+bool ct_render_thread_start(cnc_terminal *ct)
+{
+  if (ct == NULL)
+  {
+    return false;
+  }
+
+  if (ct->render_running)
   {
-    _ct_c_cursor_cmd();
+    return true;
   }
 
-  else
+  if (pthread_mutex_init(&ct->render_lock, NULL) != 0)
   {
-    _ct_c_cursor_ins();
+    return false;
   }
 
-  ct->mode = mode;
+  if (pthread_cond_init(&ct->render_cond, NULL) != 0)
+  {
+    pthread_mutex_destroy(&ct->render_lock);
+
+    return false;
+  }
+
+  ct->render_running = true;
+  ct->render_ready   = false;
+  ct->render_busy    = false;
+  ct->render_output  = (cal_usage){0};
+
+  co_usage(&ct->output, &ct->render_output);
+
+  if (pthread_create(&ct->render_thread, NULL, _ct_render_main, ct) != 0)
+  {
+    ct->render_running = false;
+
+    pthread_cond_destroy(&ct->render_cond);
+    pthread_mutex_destroy(&ct->render_lock);
+
+    return false;
+  }
+
+  return true;
+}
+
+void ct_render_thread_stop(cnc_terminal *ct)
+{
+  if (ct == NULL || ct->render_running == false)
+  {
+    return;
+  }
+
+  // the thread writes the frame left in the mailbox, then exits
+  pthread_mutex_lock(&ct->render_lock);
+  ct->render_running = false;
+  pthread_cond_broadcast(&ct->render_cond);
+  pthread_mutex_unlock(&ct->render_lock);
+
+  pthread_join(ct->render_thread, NULL);
+
+  pthread_cond_destroy(&ct->render_cond);
+  pthread_mutex_destroy(&ct->render_lock);
+
+  cal_free(&ct->allocator, ct->render_frame.bytes);
+  cal_free(&ct->allocator, ct->render_front.bytes);
+
+  memset(&ct->render_frame, 0, sizeof(ct->render_frame));
+  memset(&ct->render_front, 0, sizeof(ct->render_front));
+}
+
+void ct_resize(cnc_terminal *ct)
+{
+  if (ct == NULL || ct_get_size(ct) == false)
+  {
+    return;
+  }
+
+  // the next frame resets the screen
+  ct->clear_screen = true;
+
+  if (_ct_reserve_screenbuffer(ct) == false)
+  {
+    return;
+  }
+
+  memset(ct->screenbuffer, 0, ct->screenbuffer_size);
+
+  cc_setup(&ct->cursor, ct->scr_rows, ct->scr_cols);
+
+  ct_screenbuffer_reset(ct);
+  ct_setup_widgets(ct);
+  ct_update(ct);
+}
+
+bool ct_search(cnc_terminal *ct, cnc_widget *cw, const char *text)
+{
+  if (ct == NULL || cw == NULL || cw->type != WIDGET_DISPLAY || text == NULL)
+  {
+    return false;
+  }
+
+  if (cb_set_txt(&ct->search_pattern, text) == false)
+  {
+    return false;
+  }
+
+  return _ct_search_first(ct, cw);
+}
+
+bool ct_search_next(cnc_terminal *ct, cnc_widget *cw)
+{
+  if (ct == NULL || cw == NULL || cw->type != WIDGET_DISPLAY ||
+      ct->search_pattern.size == 0)
+  {
+    return false;
+  }
+
+  // wrap around to the oldest token when there is no match below
+  if (_ct_search_jump(ct, cw, ct->search_hit + 1))
+  {
+    return true;
+  }
+
+  return _ct_search_jump(ct, cw, cw->buffer.dropped);
 }
 
 bool ct_setup_widgets(cnc_terminal *ct)
@@ -1485,6 +2794,38 @@ bool ct_setup_widgets(cnc_terminal *ct)
   size_t mlw        = 0; // number of multi_line_widgets
   size_t global_row = 1;
 
+  // every widget is rendered again at its new place and size
+  _ct_mark_dirty(ct, CW_DIRTY_GEOMETRY);
+
+  // the split tree gives every widget its frame
+  if (ct->layout != NULL)
+  {
+    cnc_rect screen = {{1, 1}, ct->scr_cols, ct->scr_rows};
+
+    // widgets left out of the tree get no room and are not drawn
+    for (size_t i = 0; i < ct->widgets_count; i++)
+    {
+      memset(&ct->widgets[i]->frame, 0, sizeof(ct->widgets[i]->frame));
+    }
+
+    if (cl_compute(ct->layout, screen) == false)
+    {
+      return false;
+    }
+
+    for (size_t i = 0; i < ct->widgets_count; i++)
+    {
+      cnc_widget *cw = ct->widgets[i];
+
+      if (cw->frame.width > 0 && _ct_frame_fits(ct, cw) == false)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
   for (size_t i = 0; i < ct->widgets_count; i++)
   {
     switch (ct->widgets[i]->type)
@@ -1496,6 +2837,7 @@ bool ct_setup_widgets(cnc_terminal *ct)
         break;
 
       case WIDGET_DISPLAY:
+      case WIDGET_FILE:
         mlw++;
         break;
     }
@@ -1514,8 +2856,10 @@ bool ct_setup_widgets(cnc_terminal *ct)
   {
     // set correct width and resize widgets lines
     ct->widgets[i]->frame.origin.row = global_row;
+    ct->widgets[i]->frame.origin.col = 1;
 
-    if (ct->widgets[i]->type == WIDGET_DISPLAY)
+    if (ct->widgets[i]->type == WIDGET_DISPLAY ||
+        ct->widgets[i]->type == WIDGET_FILE)
     {
       if (set_display_widget < mlw)
       {
@@ -1550,18 +2894,70 @@ void ct_update(cnc_terminal *ct)
   cnc_term_token token_space  = ctt_parse_value(C_SPC);
   cnc_term_token token_blank  = ctt_parse_value(C_USC);
 
+  // append the text posted since the last frame, within the memory budget
+  _ct_drain_posts(ct);
+  _ct_memory_enforce(ct);
+
+  if (_ct_reserve_screenbuffer(ct) == false)
+  {
+    return;
+  }
+
+  ct_frame_stats *fs    = _ct_frame_stats(ct);
+  uint64_t        start = _ct_now();
+
+  CTR_BEGIN("frame");
+  memset(fs, 0, sizeof(*fs));
+
   // clear previous screenbuffer
   memset(ct->screenbuffer, 0, ct->screenbuffer_size);
 
   char *buf_ptr = ct->screenbuffer;
 
+  if (ct->clear_screen)
+  {
+    _ct_render_str(&buf_ptr, STR_FRAME_CLEAR);
+    ct->clear_screen = false;
+  }
+
+  _ct_render_str(&buf_ptr, STR_FRAME_BEGIN);
+
   for (size_t widget_index = 0; widget_index < ct->widgets_count;
        ++widget_index)
   {
     cnc_widget *cw = ct->widgets[widget_index];
 
-    if (cw == NULL)
+    // a widget without a place on screen is not drawn
+    if (cw == NULL || _ct_frame_fits(ct, cw) == false)
+    {
+      continue;
+    }
+
+    // the line index of a file grows a batch per frame, drawn or not, after
+    // the file is measured again: it may have changed under the map
+    if (cw->type == WIDGET_FILE)
+    {
+      if (cfv_sync(&cw->file, &cw->top_line))
+      {
+        cw_mark_dirty(cw, CW_DIRTY_CONTENT);
+      }
+
+      cfv_index(&cw->file, CT_INDEX_BATCH);
+    }
+
+    // a clean widget shows the rows of its last render. the buffer may be
+    // smaller than the one they were drawn in (_ct_render_publish)
+    bool  stats    = cw->type == WIDGET_INFO && ct->stats_overlay;
+    char *rendered = buf_ptr;
+
+    if (cw_dirty(cw) == 0 && stats == false)
     {
+      if (_ct_reserve_bytes(ct, &buf_ptr, &rendered, cw->drawn.size))
+      {
+        memcpy(buf_ptr, cw->drawn.bytes, cw->drawn.size);
+        buf_ptr += cw->drawn.size;
+      }
+
       continue;
     }
 
@@ -1574,58 +2970,45 @@ void ct_update(cnc_terminal *ct)
         cb_replace(&cw->buffer, &token_enter, &token_space);
         cb_replace(&cw->buffer, &token_return, &token_blank);
 
+        _ct_render_row_start(ct, cw, &buf_ptr, 0);
+
         // Skip a line for info and prompt
         if (cw->type != WIDGET_TITLE)
         {
-          // _ct_render_border_row(&buf_ptr, ct->scr_cols);
-          _ct_render_empty_row(&buf_ptr, ct->scr_cols);
-          _ct_render_enter(&buf_ptr);
+          // _ct_render_border_row(&buf_ptr, cw->frame.width);
+          _ct_render_empty_row(&buf_ptr, cw->frame.width);
+          _ct_render_row_start(ct, cw, &buf_ptr, 1);
         }
 
-        // BG and FG
-        // user defined bg and fg overwrite system defaults
-        if (cw->bg.token.value != KS_NON___ || cw->fg.token.value != KS_NON___)
+        // Style
+        // user defined style overwrites system defaults
+        cnc_style style = cw->style_main;
+
+        if (cw->style != CS_DEFAULT)
         {
-          _ct_render_color_set(&buf_ptr, cw->bg, cw->fg);
+          style = cw->style;
         }
 
-        else
+        // setting up WIDGET_PROMPT Colors
+        else if (cw->type == WIDGET_PROMPT && cw->has_focus == false)
         {
-          // setting up WIDGET_PROMPT Colors
-          if (cw->type == WIDGET_PROMPT)
-          {
-            if (cw->has_focus)
-            {
-              _ct_render_color_set(&buf_ptr, cw->bg_main, cw->fg_main);
-            }
-
-            else
-            {
-              _ct_render_color_set(&buf_ptr, cw->bg_alt, cw->fg_alt);
-            }
-          }
-
-          // setting up WIDGET_INFO Colors
-          else if (cw->type == WIDGET_INFO)
-          {
-            if (ct->focused_widget->type == WIDGET_DISPLAY)
-            {
-              _ct_render_color_set(&buf_ptr, cw->bg_alt, cw->fg_alt);
-            }
+          style = cw->style_alt;
+        }
 
-            else
-            {
-              _ct_render_color_set(&buf_ptr, cw->bg_main, cw->fg_main);
-            }
-          }
+        // setting up WIDGET_INFO Colors
+        else if (cw->type == WIDGET_INFO &&
+                 (ct->focused_widget->type == WIDGET_DISPLAY ||
+                  ct->focused_widget->type == WIDGET_FILE))
+        {
+          style = cw->style_alt;
+        }
 
-          else
-          {
-            _ct_render_color_set(&buf_ptr, cw->bg_main, cw->fg_main);
-          }
+        if (style != CS_DEFAULT)
+        {
+          _ct_render_style(ct, &buf_ptr, style);
         }
 
-        size_t line_width = ct->scr_cols;
+        size_t line_width = cw->frame.width;
         size_t padding    = 0;
 
         if (cw->type == WIDGET_PROMPT)
@@ -1637,15 +3020,39 @@ void ct_update(cnc_terminal *ct)
           buf_ptr += PROMPT_PAD;
           line_width -= (PROMPT_PAD + 1);
           padding = PROMPT_PAD;
+
+          // reverse search shows its query before the line
+          size_t label = _ct_history_label(ct, cw);
+
+          if (label > 0)
+          {
+            *buf_ptr++ = '(';
+
+            for (size_t i = 0; i < ct->history_query.size; i++)
+            {
+              _ct_render_append_token(&buf_ptr, ct->history_query.data[i]);
+            }
+
+            memcpy(buf_ptr, ") ", 2);
+            buf_ptr += 2;
+
+            line_width -= label;
+            padding += label;
+          }
         }
 
         // Text
         size_t u_bound = cw->buffer.size;
         size_t width;
 
-        if (cw->buffer.size == 0)
+        if (cw->type == WIDGET_INFO && ct->stats_overlay)
+        {
+          _ct_render_stats(ct, &buf_ptr, cw->frame.width);
+        }
+
+        else if (cw->buffer.size == 0)
         {
-          _ct_render_empty_row(&buf_ptr, ct->scr_cols - padding);
+          _ct_render_empty_row(&buf_ptr, cw->frame.width - padding);
         }
 
         else
@@ -1658,8 +3065,18 @@ void ct_update(cnc_terminal *ct)
 
           } while (width > line_width);
 
-          _ct_render_data(&buf_ptr, &cw->buffer, cw->index, u_bound,
-                          ct->scr_cols - padding);
+          // no memory for the text: drawn empty
+          if (_ct_reserve_text(ct, &buf_ptr, &rendered, &cw->buffer,
+                               cw->index, u_bound + 1))
+          {
+            _ct_render_data(ct, &buf_ptr, &cw->buffer, cw->index, u_bound,
+                            cw->frame.width - padding);
+          }
+
+          else
+          {
+            _ct_render_empty_row(&buf_ptr, cw->frame.width - padding);
+          }
         }
 
         _ct_render_color_reset(&buf_ptr);
@@ -1667,211 +3084,219 @@ void ct_update(cnc_terminal *ct)
         // add line under WIDGET_TITLE
         if (cw->type == WIDGET_TITLE)
         {
-          _ct_render_border_row(&buf_ptr, ct->scr_cols);
+          _ct_render_row_start(ct, cw, &buf_ptr, 1);
+          _ct_render_border_row(&buf_ptr, cw->frame.width);
         }
 
-        if (widget_index < ct->widgets_count - 1)
+        // a layout may give more than two rows
+        for (size_t row = 2; row < cw->frame.height; row++)
         {
-          _ct_render_enter(&buf_ptr);
+          _ct_render_row_start(ct, cw, &buf_ptr, row);
+          _ct_render_empty_row(&buf_ptr, cw->frame.width);
         }
       }
       break;
 
       case WIDGET_DISPLAY:
       {
-        // split long strings into lines, without breaking words
-        // an improtant option we have to consider is when the
-        // user sends bg and fg information within the buffer.
-        // in this case, those info will be ignored in the
-        // char array, and added at the beginning of the line.
-        // one way to achieve this is to pick a color_info_byte
-        // that will tell us that fg and bg info will follow.
-        // this color_info_byte then will be ignored
-
-        size_t row              = 0;
-        size_t counter          = 0;
-        size_t row_width        = 0;
-        size_t last_space_index = 0;
-        bool   add_new_line     = false;
-
-        ct_row_info     row_info      = {0};
-        cnc_term_token *counter_token = NULL;
-
-        // clear old rows_info
-        memset(ct->rows_info, 0, DISPLAY_BUFFER_SIZE * sizeof(*ct->rows_info));
-        size_t row_index = 0;
-
-        cw->data_index = 0;
-
-        if (cw->buffer.size == 0)
+        // long lines are split into rows without breaking words.
+        // rows are counted once per logical line and width (cnc_wrap_cache),
+        // and only the rows from the scroll anchor down are laid out
+        cnc_wrap_cache *wrap    = &cw->wrap;
+        size_t          row     = 0;
+        size_t          wrapped = wrap->wrapped;
+        uint64_t        layout  = _ct_now();
+
+        CTR_BEGIN("layout");
+        cwc_set_width(wrap, cw->frame.width);
+        cwc_sync(wrap, &cw->buffer);
+
+        // nothing to show, or no memory to lay it out
+        if (wrap->size == 0 || cw_reserve_rows(cw, cw->frame.height) == false)
         {
+          cw->scroll = 0;
+          cw->at_end = true;
+
+          CTR_END("layout");
+
           for (row = 0; row < cw->frame.height; row++)
           {
-            _ct_render_empty_row(&buf_ptr, ct->scr_cols);
+            _ct_render_row_start(ct, cw, &buf_ptr, row);
+            _ct_render_empty_row(&buf_ptr, cw->frame.width);
           }
+
           break;
         }
 
-        // flag to add newline if last character is not a newline
-        counter_token = &(cw->buffer.data[cw->buffer.size - 1]);
-        add_new_line  = counter_token->token.value != C_ENT;
+        size_t last_line = wrap->base + wrap->size - 1;
 
-        if (add_new_line)
+        // the anchor line was evicted or cleared
+        if (cw->top_line < wrap->base || cw->top_line > last_line)
         {
-          cb_push(&cw->buffer, ctt_parse_value(C_ENT));
+          cw->top_line = wrap->base;
+          cw->top_row  = 0;
         }
 
-        // calculation phase
-        while (counter < cw->buffer.size)
-        {
-          counter_token = &cw->buffer.data[counter];
-
-          row_width = cb_data_width(&cw->buffer, row_info.first_index,
-                                    counter - row_info.first_index + 1);
+        // after a resize the anchor keeps its line, and is reflowed first
+        size_t top_rows = cwc_line_rows(wrap, &cw->buffer, cw->top_line);
 
-          if (counter_token->token.value == C_ENT)
-          {
-            cw->data_index++;
+        if (cw->top_row >= top_rows)
+        {
+          cw->top_row = top_rows - 1;
+        }
 
-            if (counter > 0)
-            {
-              row_info.last_index = counter - 1;
-            }
+        if (cw->scroll != 0)
+        {
+          cwc_move(wrap, &cw->buffer, &cw->top_line, &cw->top_row,
+                   cw->scroll);
 
-            else
-            {
-              row_info.last_index = 0;
-            }
+          cw->scroll = 0;
+        }
 
-            row_info.is_valid          = 1;
-            ct->rows_info[row_index++] = row_info;
-            row_info.first_index = ct->rows_info[row_index - 1].last_index + 2;
+        // new text scrolls into view while the last row is visible
+        else if (cw->follow && cw->at_end)
+        {
+          cw->top_line = last_line;
+          cw->top_row  = cwc_line_rows(wrap, &cw->buffer, last_line) - 1;
+        }
 
-            row_info.bg = CTT_PV(0);
-            row_info.fg = CTT_PV(0);
-            counter++;
+        // calculation phase: rows from the anchor only, moving the anchor
+        // up when the text ends before the bottom of the widget
+        for (size_t pass = 0; pass < 2; pass++)
+        {
+          size_t line   = cw->top_line;
+          size_t offset = cw->top_row;
 
-            continue;
-          }
+          row = 0;
 
-          if (row_width > ct->scr_cols)
+          while (row < cw->frame.height && line <= last_line)
           {
-            cw->data_index++;
+            size_t count =
+              cwc_wrap(wrap, &cw->buffer, line, offset, &cw->rows[row],
+                       cw->frame.height - row);
 
-            if (last_space_index > row_info.first_index)
-            {
-              row_info.last_index = last_space_index - 1;
-              counter             = last_space_index + 1;
-
-              // Skip any additional whitespace after wrap
-              while (counter < cw->buffer.size &&
-                     ctt_is_whitespace(cw->buffer.data[counter]))
-              {
-                counter++;
-              }
-            }
+            row += count;
 
-            else
+            if (offset + count < cwc_line_rows(wrap, &cw->buffer, line))
             {
-              // No whitespace to wrap at so wrap at current counter
-              row_info.last_index = counter - 1;
+              break;
             }
 
-            row_info.is_valid          = 1;
-            ct->rows_info[row_index++] = row_info;
-
-            // Prepare next row_info
-            row_info.first_index = counter;
-            row_info.bg          = ct->rows_info[row_index - 1].bg;
-            row_info.fg          = ct->rows_info[row_index - 1].fg;
-
-            continue;
+            line++;
+            offset = 0;
           }
 
-          if (ctt_is_whitespace(*counter_token))
-          {
-            last_space_index = counter++;
-            continue;
-          }
+          cw->at_end = line > last_line;
 
-          // Colors decryption
-          if (counter_token->token.value == C_COL)
+          if (row == cw->frame.height || pass > 0)
           {
-            cnc_term_token token_color_value;
+            break;
+          }
 
-            int color_operation = _ct_color_code_to_color(
-              (counter_token + 1)->token.value, &token_color_value);
+          cwc_move(wrap, &cw->buffer, &cw->top_line, &cw->top_row,
+                   (ptrdiff_t)row - (ptrdiff_t)cw->frame.height);
+        }
 
-            if (color_operation == 1)
-            {
-              row_info.bg = token_color_value;
-            }
+        // other lines are reflowed a batch per frame
+        cwc_reflow(wrap, &cw->buffer, CT_REFLOW_BATCH);
+        CTR_END("layout");
 
-            if (color_operation == 2)
-            {
-              row_info.fg = token_color_value;
-            }
+        fs->layout_ns += _ct_now() - layout;
+        fs->rows_wrapped += wrap->wrapped - wrapped;
 
-            counter += 2;
-            continue;
-          }
+        size_t visible_rows = row;
 
-          counter++;
+        // no memory for the text of the rows: drawn empty
+        if (row > 0 &&
+            _ct_reserve_text(ct, &buf_ptr, &rendered, &cw->buffer,
+                             cw->rows[0].start - cw->buffer.dropped,
+                             cw->rows[row - 1].end - cw->buffer.dropped) ==
+              false)
+        {
+          visible_rows = 0;
         }
 
         // rendering phase
-        for (row = 0; row < cw->frame.height; row++)
+        CTR_BEGIN("render rows");
+
+        for (row = 0; row < visible_rows; row++)
         {
-          size_t r = row + cw->index;
+          cwc_row *r = &cw->rows[row];
 
-          if (ct->rows_info[r].is_valid == 0)
-          {
-            break;
-          }
+          _ct_render_row_start(ct, cw, &buf_ptr, row);
 
-          if (ct->rows_info[r].bg.token.value > 0)
+          if (r->start == r->end)
           {
-            _ct_render_append_token(&buf_ptr, ct->rows_info[r].bg);
+            _ct_render_empty_row(&buf_ptr, cw->frame.width);
           }
 
-          if (ct->rows_info[r].fg.token.value > 0)
+          else
           {
-            _ct_render_append_token(&buf_ptr, ct->rows_info[r].fg);
+            _ct_render_data(ct, &buf_ptr, &cw->buffer,
+                            r->start - cw->buffer.dropped,
+                            r->end - cw->buffer.dropped - 1, cw->frame.width);
           }
 
-          _ct_render_data(&buf_ptr, &cw->buffer, ct->rows_info[r].first_index,
-                          ct->rows_info[r].last_index, ct->scr_cols);
-
           _ct_render_color_reset(&buf_ptr);
-
-          if (row < cw->frame.height - 1)
-          {
-            _ct_render_enter(&buf_ptr);
-          }
         }
 
         while (row < cw->frame.height)
         {
-          _ct_render_empty_row(&buf_ptr, ct->scr_cols);
-          _ct_render_enter(&buf_ptr);
+          _ct_render_row_start(ct, cw, &buf_ptr, row);
+          _ct_render_empty_row(&buf_ptr, cw->frame.width);
 
           row++;
         }
 
-        // remove the newline from the end of the buffer
-        // this was added for lines calculation
-        if (add_new_line)
-        {
-          cb_remove(&cw->buffer, cw->buffer.size - 1);
-        }
+        CTR_END("render rows");
+
+        // index the text appended since the last frame
+        csi_sync(&cw->search, &cw->buffer);
       }
       break;
+
+      case WIDGET_FILE:
+      {
+        CTR_BEGIN("file rows");
+        _ct_render_file(ct, cw, &buf_ptr);
+        CTR_END("file rows");
+      }
+      break;
+    }
+
+    cw_store_render(cw, rendered, buf_ptr - rendered);
+
+    // the stats change every frame
+    if (stats)
+    {
+      cw_mark_dirty(cw, CW_DIRTY_CONTENT);
     }
   }
 
+  _ct_render_completion(ct, &buf_ptr);
+  _ct_render_cursor(ct, &buf_ptr);
+
   // add null termination
-  *buf_ptr = '\0';
+  *buf_ptr       = '\0';
+  ct->frame_size = buf_ptr - ct->screenbuffer;
+
+  // the render thread counts its own writes, its output is not read here
+  uint64_t composed = _ct_now();
+  size_t   syscalls = ct->render_running ? 0 : ct->output.syscalls;
+
+  fs->render_ns = composed - start - fs->layout_ns;
+  fs->bytes     = ct->frame_size;
 
   // redraw the terminal
   _ct_redraw(ct);
+
+  fs->write_ns = _ct_now() - composed;
+
+  if (ct->render_running == false)
+  {
+    fs->syscalls = ct->output.syscalls - syscalls;
+  }
+
+  ct->stats_count++;
+  CTR_END("frame");
 }
@@ -3,21 +3,80 @@
 
 // using ct as shorthand for cnc_terminal
 
+#include <pthread.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/ioctl.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "cnc_allocator.h"
+#include "cnc_backend.h"
 #include "cnc_buffer.h"
+#include "cnc_completion.h"
 #include "cnc_cursor.h"
+#include "cnc_history.h"
+#include "cnc_layout.h"
+#include "cnc_output.h"
+#include "cnc_style.h"
+#include "cnc_trace.h"
 #include "cnc_widget.h"
 
 // Reset styles constant
 #define STR_RESET_STYLES "\x1b[0m"
 
+// frames hide the cursor and start at home, after a resize they reset the
+// screen first. the cursor shape follows the mode
+#define STR_FRAME_BEGIN "\x1b[?25l\x1b[H"
+#define STR_FRAME_CLEAR "\x1b\x63"
+#define STR_CURSOR_CMD  "\x1b[1 q"
+#define STR_CURSOR_INS  "\x1b[5 q"
+#define STR_CURSOR_SHOW "\x1b[?25h"
+
+// screenbuffer bytes per cell: 4 bytes of UTF-8. style changes inside a
+// row are reserved per span when the row is drawn (_ct_reserve_text)
+#define CT_CELL_BYTES 4
+
+// screenbuffer bytes per widget row on top of the cells: placement, color
+// reset, prompt symbol, and the widget style and the span open at the
+// first cell (one SGR sequence each)
+#define CT_ROW_BYTES (64 + 2 * CS_SGR_MAX)
+
+// digits of the largest size_t, as printed by %zu
+#define CT_NUMBER_BYTES 20
+
+// screenbuffer bytes per frame on top of the rows: prefix, cursor shape,
+// and the cursor placement of _ct_render_cursor with full width numbers
+#define CT_FRAME_BYTES                                                         \
+  (sizeof(STR_FRAME_CLEAR STR_FRAME_BEGIN STR_CURSOR_CMD) +                    \
+   sizeof("\x1b[;H" STR_CURSOR_SHOW) + 2 * CT_NUMBER_BYTES)
+
+// render thread wait for a full terminal before looking for newer frames
+#define CT_OUTPUT_WAIT_MS 100
+
+// frames kept for ct_frame_stats_summary
+#define CT_STATS_WINDOW 64
+
+// posted messages appended to each widget per frame (ct_post_text)
+#define CT_POST_BATCH 256
+
+// display lines reflowed in the background per frame after a resize
+#define CT_REFLOW_BATCH 256
+
+// file bytes line-indexed per frame, for every file widget
+#define CT_INDEX_BATCH (1024 * 1024)
+
+// tab completion matches listed above the prompt, and the list width
+#define CT_COMPLETION_ROWS  8
+#define CT_COMPLETION_WIDTH 40
+
+// block size of the arena holding allocations that live as long as the
+// terminal (bigger requests get a block of their own)
+#define CT_ARENA_BLOCK_SIZE 4096
+
 typedef enum
 {
   MODE_CMD, // command mode
@@ -34,16 +93,82 @@ typedef struct
 
 typedef struct
 {
-  int8_t         is_valid;
-  size_t         first_index; // display token index included
-  size_t         last_index;  // display token index included
-  cnc_term_token bg;          // row background color
-  cnc_term_token fg;          // row foreground color
+  char  *bytes;
+  size_t size;     // bytes of the frame
+  size_t capacity; // bytes allocated
+
+} ct_frame;
+
+// what one ct_update cost. with the render thread running, write_ns is
+// the hand-off to the thread and syscalls are not counted
+typedef struct
+{
+  uint64_t layout_ns;    // display wrapping and scroll anchoring
+  uint64_t render_ns;    // composing the frame, layout excluded
+  uint64_t write_ns;     // handing the frame to the output
+  size_t   rows_wrapped; // rows produced by wrap passes
+  size_t   tokens;       // tokens rendered
+  size_t   bytes;        // frame size
+  size_t   syscalls;     // output writes and waits
+
+} ct_frame_stats;
+
+typedef struct
+{
+  size_t         frames; // frames in the window
+  ct_frame_stats mean;
+  ct_frame_stats max;
+
+} ct_stats_summary;
+
+// memory held by a terminal, by component (ct_memory_usage)
+typedef enum
+{
+  CT_MEMORY_TERMINAL, // terminal, widgets array and widgets
+  CT_MEMORY_SCREEN,   // screenbuffer, render thread frames, widget renders
+  CT_MEMORY_OUTPUT,   // frames on their way to the terminal
+  CT_MEMORY_TEXT,     // widget buffers with their styles, search, history
+  CT_MEMORY_LAYOUT,   // wrap caches, laid out rows, file line indexes
+  CT_MEMORY_SEARCH,   // search indexes
+  CT_MEMORY_COUNT
+
+} ct_memory_component;
+
+typedef struct
+{
+  cal_usage components[CT_MEMORY_COUNT];
+  cal_usage total;
+
+} ct_memory;
+
+// tab completion of the word before the prompt cursor (ct_set_completion)
+typedef struct
+{
+  cnc_completion *candidates; // belongs to the app, NULL: Tab moves focus
+  ccp_match       match;      // matches of the typed word
+
+  char   word[CCP_TEXT_MAX]; // typed word
+  size_t word_length;        // bytes of the typed word
+  size_t start;              // prompt index of the word
+  size_t typed;              // tokens of the typed word
+  size_t index;              // match shown, match.count for the typed word
+  bool   open;               // matches listed, Tab cycles them
 
-} ct_row_info;
+  cnc_style style_main;
+  cnc_style style_alt; // match shown
+
+} ct_completion;
 
 typedef struct
 {
+  // memory: general purpose allocator, and arena for terminal lifetime data
+  cnc_allocator allocator;
+  cnc_arena     arena;
+  cnc_allocator arena_allocator;
+
+  // reserved bytes allowed, 0 for no limit (ct_set_memory_budget)
+  size_t memory_budget;
+
   // signal handling struct
   struct sigaction sa_resize;
   struct sigaction sa_sigtstp;
@@ -52,20 +177,65 @@ typedef struct
   size_t         min_height;
   size_t         scr_rows;
   size_t         scr_cols;
-  struct termios orig_term;
   bool           in_raw_mode;
   bool           can_change_mode;
   bool           can_change_focus;
   ct_mode        mode;
   char          *screenbuffer;
   size_t         screenbuffer_size;
+  size_t         frame_size;
+  bool           clear_screen;
+
+  // where keys come from and frames go, cbe_tty unless set at init
+  cnc_backend backend;
+  cnc_output  output;
+
+  // the last CT_STATS_WINDOW frames, stats_count frames so far.
+  // stats_overlay shows their summary in the info bar
+  ct_frame_stats stats[CT_STATS_WINDOW];
+  size_t         stats_count;
+  bool           stats_overlay;
   uint8_t        widgets_count;
   cnc_widget   **widgets;
   cnc_widget    *focused_widget;
   cnc_widget    *main_display_widget;
-  ct_row_info   *rows_info;
   cnc_cursor     cursor;
 
+  // split tree placing the widgets (ct_set_layout), NULL to stack them
+  cnc_layout *layout;
+
+  // encoded SGR sequences of the styles used when rendering
+  cs_sgr_cache sgr_cache;
+
+  // last search pattern and absolute position of the current match
+  cnc_buffer search_pattern;
+  size_t     search_hit;
+
+  // lines entered in the prompt (Up/Down, Ctrl-R). history_line keeps the
+  // typed line while browsing, history_query the reverse search query
+  cnc_history history;
+  cnc_buffer  history_line;
+  cnc_buffer  history_query;
+  bool        history_search;
+
+  ct_completion completion;
+
+  // optional render thread (ct_render_thread_start). frames go through a
+  // one slot mailbox: a new frame replaces one not written yet, so the
+  // writer always skips to the newest
+  pthread_t       render_thread;
+  pthread_mutex_t render_lock;
+  pthread_cond_t  render_cond;
+  bool            render_running;
+  bool            render_ready; // render_frame holds an unwritten frame
+  bool            render_busy;  // output has bytes left to write
+  ct_frame        render_frame; // mailbox, swapped with the screenbuffer
+  ct_frame        render_front; // last frame taken by the render thread
+
+  // the output belongs to the render thread while it runs: the UI thread
+  // reads its usage from this copy, taken under render_lock after a write
+  cal_usage render_output;
+
 } cnc_terminal;
 
 typedef void (*ActionFunc)(cnc_terminal *ct);
@@ -79,6 +249,8 @@ typedef struct
 
 // main functions
 cnc_widget *ct_add_widget(cnc_terminal *ct, cw_type type);
+cnc_widget *ct_add_widget_with_capacity(cnc_terminal *ct, cw_type type,
+                                        size_t capacity);
 
 void ct_check_for_resize(cnc_terminal *ct);
 void ct_destroy(cnc_terminal *ct);
@@ -87,12 +259,32 @@ void ct_focus_widget(cnc_terminal *ct, cnc_widget *cw);
 
 cnc_widget *ct_focused_widget(cnc_terminal *ct);
 
+const ct_frame_stats *ct_frame_stats_last(const cnc_terminal *ct);
+
+bool ct_frame_stats_summary(const cnc_terminal *ct, ct_stats_summary *summary);
+
 bool ct_get_size(cnc_terminal *ct);
 int  ct_get_user_input(cnc_terminal *ct);
 
 cnc_terminal *ct_init(size_t min_height, size_t min_width);
+cnc_terminal *ct_init_with_allocator(size_t min_height, size_t min_width,
+                                     const cnc_allocator *allocator);
+cnc_terminal *ct_init_with_backend(size_t min_height, size_t min_width,
+                                   const cnc_allocator *allocator,
+                                   const cnc_backend   *backend);
+
+void ct_memory_usage(cnc_terminal *ct, ct_memory *memory);
+bool ct_post_text(cnc_widget *cw, const char *bytes, size_t length);
+bool ct_render_thread_start(cnc_terminal *ct);
+void ct_render_thread_stop(cnc_terminal *ct);
+void ct_resize(cnc_terminal *ct);
 
 void ct_screenbuffer_reset(cnc_terminal *ct);
+bool ct_search(cnc_terminal *ct, cnc_widget *cw, const char *text);
+bool ct_search_next(cnc_terminal *ct, cnc_widget *cw);
+void ct_set_completion(cnc_terminal *ct, cnc_completion *candidates);
+bool ct_set_layout(cnc_terminal *ct, cnc_layout *layout);
+bool ct_set_memory_budget(cnc_terminal *ct, size_t budget);
 void ct_set_mode(cnc_terminal *ct, ct_mode mode);
 bool ct_setup_widgets(cnc_terminal *ct);
 void ct_update(cnc_terminal *ct);
@@ -0,0 +1,116 @@
+#include "cnc_trace.h"
+
+#ifdef CNC_TRACE
+/*
+ * lock-free ring: a writer claims a slot with one atomic add on head, fills
+ * it and publishes it by storing seq (claim + 1) last, with release. once
+ * the ring wraps, the oldest events are overwritten. ctr_dump reads seq
+ * before and after copying an event and skips the ones changed under it.
+ */
+static ctr_event ctr_ring[CTR_RING_SIZE];
+static uint64_t  ctr_head;
+
+// cached per thread, gettid is a syscall
+static __thread uint32_t ctr_tid;
+#endif
+
+// private functions declaration
+#ifdef CNC_TRACE
+static uint64_t _ctr_now(void);
+#endif
+
+// private functions definition
+#ifdef CNC_TRACE
+static uint64_t _ctr_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+// main functions
+void ctr_clear(void)
+{
+#ifdef CNC_TRACE
+  for (size_t i = 0; i < CTR_RING_SIZE; i++)
+  {
+    __atomic_store_n(&ctr_ring[i].seq, 0, __ATOMIC_RELAXED);
+  }
+
+  __atomic_store_n(&ctr_head, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+bool ctr_dump(FILE *out)
+{
+  // chrome trace event format, timestamps in microseconds
+  fprintf(out, "{\"traceEvents\":[");
+
+#ifdef CNC_TRACE
+  uint64_t head  = __atomic_load_n(&ctr_head, __ATOMIC_ACQUIRE);
+  uint64_t first = head > CTR_RING_SIZE ? head - CTR_RING_SIZE : 0;
+  pid_t    pid   = getpid();
+  bool     comma = false;
+
+  for (uint64_t n = first; n < head; n++)
+  {
+    ctr_event *slot = &ctr_ring[n & (CTR_RING_SIZE - 1)];
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != n + 1)
+    {
+      continue;
+    }
+
+    ctr_event event = *slot;
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != n + 1)
+    {
+      continue;
+    }
+
+    fprintf(out,
+            "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+            "\"pid\":%d,\"tid\":%u%s}",
+            comma ? "," : "", event.name, event.phase, event.ts / 1e3,
+            (int)pid, event.tid, event.phase == 'i' ? ",\"s\":\"t\"" : "");
+
+    comma = true;
+  }
+#endif
+
+  fprintf(out, "\n]}\n");
+
+  return ferror(out) == 0;
+}
+
+void ctr_record(const char *name, char phase)
+{
+#ifdef CNC_TRACE
+  if (ctr_tid == 0)
+  {
+    ctr_tid = (uint32_t)syscall(SYS_gettid);
+  }
+
+  uint64_t   n    = __atomic_fetch_add(&ctr_head, 1, __ATOMIC_RELAXED);
+  ctr_event *slot = &ctr_ring[n & (CTR_RING_SIZE - 1)];
+
+  // a reader seeing the old seq skips the slot while it is rewritten
+  __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  slot->name  = name;
+  slot->ts    = _ctr_now();
+  slot->tid   = ctr_tid;
+  slot->phase = phase;
+
+  __atomic_store_n(&slot->seq, n + 1, __ATOMIC_RELEASE);
+#else
+  (void)name;
+  (void)phase;
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef CNC_TRACE_H
+#define CNC_TRACE_H
+
+// using ctr as shorthand for cnc_trace
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// trace ring size (events), a power of two
+#define CTR_RING_SIZE 65536
+
+// phase markers, compiled only with -DCNC_TRACE (make TRACE=1).
+// names must be string literals: the ring keeps the pointer
+#ifdef CNC_TRACE
+#define CTR_BEGIN(name)   ctr_record((name), 'B')
+#define CTR_END(name)     ctr_record((name), 'E')
+#define CTR_INSTANT(name) ctr_record((name), 'i')
+#else
+#define CTR_BEGIN(name)   ((void)0)
+#define CTR_END(name)     ((void)0)
+#define CTR_INSTANT(name) ((void)0)
+#endif
+
+typedef struct
+{
+  const char *name;
+  uint64_t    ts;    // CLOCK_MONOTONIC, ns
+  uint64_t    seq;   // claim number + 1 once written, 0 while empty
+  uint32_t    tid;
+  char        phase; // chrome trace phase: 'B', 'E' or 'i'
+
+} ctr_event;
+
+// main functions
+void ctr_clear(void);
+bool ctr_dump(FILE *out);
+void ctr_record(const char *name, char phase);
+
+#endif
@@ -8,21 +8,54 @@ void cw_destroy(cnc_widget **cw)
   }
 
   cb_destroy(&(*cw)->buffer);
+  cq_destroy(&(*cw)->posts);
+  csi_destroy(&(*cw)->search);
+  cwc_destroy(&(*cw)->wrap);
+  cfv_close(&(*cw)->file);
+  cal_free((*cw)->allocator, (*cw)->rows);
+  cal_free((*cw)->allocator, (*cw)->drawn.bytes);
 
-  free(*cw);
+  cal_free((*cw)->allocator, *cw);
 
   *cw = NULL;
 }
 
-cnc_widget *cw_init(cw_type type)
+uint8_t cw_dirty(const cnc_widget *cw)
 {
-  cnc_widget *cw = malloc(sizeof(*cw));
+  if (cw == NULL)
+  {
+    return 0;
+  }
+
+  const cw_render_cache *drawn = &cw->drawn;
+  uint8_t                dirty = cw->dirty;
+
+  if (cw->buffer.changes != drawn->changes || cw->style != drawn->style)
+  {
+    dirty |= CW_DIRTY_CONTENT;
+  }
+
+  if (cw->scroll != 0 || cw->index != drawn->index ||
+      cw->top_line != drawn->top_line || cw->top_row != drawn->top_row)
+  {
+    dirty |= CW_DIRTY_SCROLL;
+  }
+
+  return dirty;
+}
+
+cnc_widget *cw_init(cw_type type, size_t capacity,
+                    const cnc_allocator *allocator)
+{
+  cnc_widget *cw = cal_alloc(allocator, sizeof(*cw));
 
   if (cw == NULL)
   {
     return NULL;
   }
 
+  cw->allocator = allocator;
+
   size_t buffer_size   = 0;
   cw->frame.origin.col = 1;
   cw->frame.origin.row = 1;
@@ -34,24 +67,41 @@ cnc_widget *cw_init(cw_type type)
   cw->index      = 0;
   cw->data_index = 0;
 
-  cw->bg = ctt_parse_value(KS_NON___);
-  cw->fg = ctt_parse_value(KS_NON___);
-
-  cw->bg_main = ctt_parse_value(KS_NON___);
-  cw->fg_main = ctt_parse_value(KS_NON___);
+  cw->top_line = 0;
+  cw->top_row  = 0;
+  cw->scroll   = 0;
+  cw->at_end   = true;
+  cw->follow   = false;
 
-  cw->bg_alt = ctt_parse_value(KS_NON___);
-  cw->fg_alt = ctt_parse_value(KS_NON___);
+  cw->style      = CS_DEFAULT;
+  cw->style_main = CS_DEFAULT;
+  cw->style_alt  = CS_DEFAULT;
 
   cw->has_focus = false;
 
+  // nothing rendered yet
+  cw->dirty = CW_DIRTY_ALL;
+  memset(&cw->drawn, 0, sizeof(cw->drawn));
+
+  cw->search.buckets      = NULL;
+  cw->search.buckets_size = 0;
+
+  cq_init(&cw->posts);
+
+  cwc_init(&cw->wrap, allocator);
+
+  cw->rows          = NULL;
+  cw->rows_capacity = 0;
+
+  cfv_init(&cw->file, allocator);
+
   switch (type)
   {
     case WIDGET_TITLE:
-      buffer_size   = INFO_BUFFER_SIZE;
-      cw->fg_main   = ctt_parse_value(KS_GRE_FG);
-      cw->fg_alt    = ctt_parse_value(KS_YEL_FG);
-      cw->can_focus = false;
+      buffer_size    = INFO_BUFFER_SIZE;
+      cw->style_main = CS_STYLE(CS_GREEN, CS_DEFAULT_COLOR, 0);
+      cw->style_alt  = CS_STYLE(CS_YELLOW, CS_DEFAULT_COLOR, 0);
+      cw->can_focus  = false;
       break;
 
     case WIDGET_DISPLAY:
@@ -60,28 +110,100 @@ cnc_widget *cw_init(cw_type type)
       break;
 
     case WIDGET_INFO:
-      buffer_size   = INFO_BUFFER_SIZE;
-      cw->bg_main   = ctt_parse_value(KS_GRE_BG);
-      cw->fg_main   = ctt_parse_value(KS_BLA_FG);
-      cw->bg_alt    = ctt_parse_value(KS_YEL_BG);
-      cw->fg_alt    = ctt_parse_value(KS_BLA_FG);
-      cw->can_focus = false;
+      buffer_size    = INFO_BUFFER_SIZE;
+      cw->style_main = CS_STYLE(CS_BLACK, CS_GREEN, 0);
+      cw->style_alt  = CS_STYLE(CS_BLACK, CS_YELLOW, 0);
+      cw->can_focus  = false;
       break;
 
     case WIDGET_PROMPT:
-      buffer_size = PROMPT_BUFFER_SIZE;
-      // cw->background = ctt_parse_value(KS_BLA_BG);
-      cw->fg_main   = ctt_parse_value(KS_CYA_FG);
-      cw->fg_alt    = ctt_parse_value(KS_RED_FG);
+      buffer_size    = PROMPT_BUFFER_SIZE;
+      cw->style_main = CS_STYLE(CS_CYAN, CS_DEFAULT_COLOR, 0);
+      cw->style_alt  = CS_STYLE(CS_RED, CS_DEFAULT_COLOR, 0);
+      cw->can_focus  = true;
+      break;
+
+    case WIDGET_FILE:
+      buffer_size   = FILE_BUFFER_SIZE;
       cw->can_focus = true;
       break;
   }
 
-  cb_init(&cw->buffer, buffer_size);
+  if (capacity > 0)
+  {
+    buffer_size = capacity;
+  }
+
+  cb_init_with_allocator(&cw->buffer, buffer_size, allocator);
+
+  // the search index is sized to the text the display can hold
+  if (type == WIDGET_DISPLAY)
+  {
+    csi_init(&cw->search, allocator, buffer_size);
+  }
+
+  // display text can be huge: only measure what gets laid out
+  cw->buffer.lazy_width = type == WIDGET_DISPLAY;
 
   return cw;
 }
 
+void cw_mark_dirty(cnc_widget *cw, uint8_t bits)
+{
+  if (cw == NULL)
+  {
+    return;
+  }
+
+  cw->dirty |= bits;
+}
+
+bool cw_open_file(cnc_widget *cw, const char *path)
+{
+  if (cw == NULL || cw->type != WIDGET_FILE)
+  {
+    return false;
+  }
+
+  // mapped, not read: opening takes the same time for any file size
+  bool opened = cfv_open(&cw->file, path);
+
+  cw->top_line = 0;
+  cw->top_row  = 0;
+  cw->scroll   = 0;
+
+  cw_mark_dirty(cw, CW_DIRTY_CONTENT);
+
+  return opened;
+}
+
+bool cw_reserve_rows(cnc_widget *cw, size_t count)
+{
+  if (cw == NULL)
+  {
+    return false;
+  }
+
+  // follows the frame height both ways: only visible rows are kept
+  if (cw->rows_capacity == count)
+  {
+    return true;
+  }
+
+  cwc_row *new_rows =
+    cal_realloc(cw->allocator, cw->rows, count * sizeof(*new_rows));
+
+  if (new_rows == NULL && count > 0)
+  {
+    return false;
+  }
+
+  cw->rows          = new_rows;
+  cw->rows_capacity = count;
+
+  return true;
+}
+
 void cw_reset(cnc_widget *cw)
 {
   if (cw == NULL)
@@ -92,4 +214,77 @@ void cw_reset(cnc_widget *cw)
   cb_clear(&cw->buffer);
   cw->data_index = 0;
   cw->index      = 0;
+  cw->scroll     = 0;
+  cw->at_end     = true;
+}
+
+bool cw_set_capacity(cnc_widget *cw, size_t capacity)
+{
+  if (cw == NULL || capacity == 0)
+  {
+    return false;
+  }
+
+  // a smaller buffer evicts its oldest text
+  if (cb_set_max_capacity(&cw->buffer, capacity) == false)
+  {
+    return false;
+  }
+
+  if (cw->index > cw->buffer.size)
+  {
+    cw->index = cw->buffer.size;
+  }
+
+  if (cw->data_index > cw->buffer.size)
+  {
+    cw->data_index = cw->buffer.size;
+  }
+
+  // the search index is rebuilt at its new size by the next sync
+  if (cw->search.buckets != NULL)
+  {
+    csi_destroy(&cw->search);
+
+    return csi_init(&cw->search, cw->allocator, capacity);
+  }
+
+  return true;
+}
+
+bool cw_store_render(cnc_widget *cw, const char *bytes, size_t size)
+{
+  if (cw == NULL)
+  {
+    return false;
+  }
+
+  cw_render_cache *drawn = &cw->drawn;
+
+  if (drawn->capacity < size)
+  {
+    char *new_bytes = cal_realloc(cw->allocator, drawn->bytes, size);
+
+    if (new_bytes == NULL)
+    {
+      // stays dirty: rendered again next time
+      return false;
+    }
+
+    drawn->bytes    = new_bytes;
+    drawn->capacity = size;
+  }
+
+  memcpy(drawn->bytes, bytes, size);
+
+  drawn->size     = size;
+  drawn->changes  = cw->buffer.changes;
+  drawn->index    = cw->index;
+  drawn->top_line = cw->top_line;
+  drawn->top_row  = cw->top_row;
+  drawn->style    = cw->style;
+
+  cw->dirty = 0;
+
+  return true;
 }
@@ -5,14 +5,28 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "cnc_buffer.h"
+#include "cnc_file_view.h"
+#include "cnc_queue.h"
+#include "cnc_search_index.h"
+#include "cnc_wrap_cache.h"
 
-// max memory sizes
+// default buffer capacities (tokens), see ct_add_widget_with_capacity
 #define INFO_BUFFER_SIZE    511
 #define PROMPT_BUFFER_SIZE  511
 #define DISPLAY_BUFFER_SIZE 32767
+#define FILE_BUFFER_SIZE    1 // the text stays in the file
+
+// reasons to render a widget again (cw_mark_dirty, cw_dirty)
+#define CW_DIRTY_CONTENT  0x01 // text, styles
+#define CW_DIRTY_SCROLL   0x02 // first visible token or row
+#define CW_DIRTY_FOCUS    0x04 // focus, mode, colors
+#define CW_DIRTY_GEOMETRY 0x08 // frame, screen size, position
+#define CW_DIRTY_ALL      0x0F
 
 // prompt symbols
 #define PROMPT_PAD 3
@@ -25,6 +39,7 @@ typedef enum
   WIDGET_DISPLAY,
   WIDGET_INFO,
   WIDGET_PROMPT,
+  WIDGET_FILE,
 
 } cw_type;
 
@@ -43,6 +58,21 @@ typedef struct
 
 } cnc_rect;
 
+// bytes of the last render of a widget, and the state they show
+typedef struct
+{
+  char  *bytes;
+  size_t size;
+  size_t capacity;
+
+  size_t    changes;  // buffer changes (cnc_buffer)
+  size_t    index;    // first visible token (title, info, prompt)
+  size_t    top_line; // first visible row (display)
+  size_t    top_row;
+  cnc_style style;
+
+} cw_render_cache;
+
 typedef struct
 {
   cnc_rect frame;
@@ -54,28 +84,65 @@ typedef struct
   // data_index: index of cursor in the data
   size_t data_index;
 
+  // display widgets scroll by anchor: the first visible row is row top_row
+  // of line top_line (a cnc_wrap_cache line number)
+  size_t    top_line;
+  size_t    top_row;
+  ptrdiff_t scroll; // rows to move the anchor by at the next layout
+  bool      at_end; // the last row was visible at the last layout
+  bool      follow; // keep the last row visible when new text arrives
+
   cnc_buffer buffer;
 
-  // info and prompt have homogeneous bg and fg colors
-  cnc_term_token bg;
-  cnc_term_token fg;
+  // text posted by other threads (ct_post_text), appended before a frame
+  cnc_queue posts;
 
-  cnc_term_token bg_main;
-  cnc_term_token fg_main;
+  // display widgets keep their text indexed for search
+  cnc_search_index search;
 
-  cnc_term_token bg_alt;
-  cnc_term_token fg_alt;
+  // display widgets count the rows of each line once per width
+  cnc_wrap_cache wrap;
+
+  // display widgets lay out their visible rows here, sized to the frame
+  cwc_row *rows;
+  size_t   rows_capacity;
+
+  // file widgets show a file mapped in memory (cw_open_file). top_line is
+  // the offset of their first visible row, top_row is not used
+  cnc_file_view file;
+
+  // info and prompt have a homogeneous style.
+  // style (user defined) overwrites style_main and style_alt when set
+  cnc_style style;
+  cnc_style style_main;
+  cnc_style style_alt;
 
   bool can_focus;
   bool has_focus;
 
+  // a clean widget reuses its last render. dirty holds CW_DIRTY_* bits
+  // set by the library, text and view changes made by the app straight
+  // to the widget are found by comparing with the render cache
+  uint8_t         dirty;
+  cw_render_cache drawn;
+
+  const cnc_allocator *allocator;
+
 } cnc_widget;
 
 // main functions
 void cw_destroy(cnc_widget **cw);
 
-cnc_widget *cw_init(cw_type type);
+uint8_t cw_dirty(const cnc_widget *cw);
+
+cnc_widget *cw_init(cw_type type, size_t capacity,
+                    const cnc_allocator *allocator);
 
+void cw_mark_dirty(cnc_widget *cw, uint8_t bits);
+bool cw_open_file(cnc_widget *cw, const char *path);
+bool cw_reserve_rows(cnc_widget *cw, size_t count);
 void cw_reset(cnc_widget *cw);
+bool cw_set_capacity(cnc_widget *cw, size_t capacity);
+bool cw_store_render(cnc_widget *cw, const char *bytes, size_t size);
 
 #endif
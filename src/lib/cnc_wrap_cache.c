@@ -0,0 +1,508 @@
+#include "cnc_wrap_cache.h"
+
+// private functions declaration
+static cwc_line *_cwc_add(cnc_wrap_cache *cwc, size_t position);
+static void      _cwc_drop(cnc_wrap_cache *cwc, size_t count);
+static bool      _cwc_row(cnc_buffer *cb, const cwc_line *line, size_t width,
+                          size_t *position, cwc_row *row);
+static size_t    _cwc_wrap_line(cnc_buffer *cb, const cwc_line *line,
+                                size_t width, size_t first_row, cwc_row *rows,
+                                size_t max_rows);
+
+// private functions definition
+static cwc_line *_cwc_add(cnc_wrap_cache *cwc, size_t position)
+{
+  if (cwc->size >= cwc->capacity)
+  {
+    size_t new_capacity =
+      cwc->capacity == 0 ? CWC_LINES_INIT_CAP : cwc->capacity * 2;
+
+    cwc_line *new_lines = cal_realloc(cwc->allocator, cwc->lines,
+                                      new_capacity * sizeof(*new_lines));
+
+    if (new_lines == NULL)
+    {
+      return NULL;
+    }
+
+    cwc->lines    = new_lines;
+    cwc->capacity = new_capacity;
+  }
+
+  cwc_line *line = &cwc->lines[cwc->size++];
+
+  line->start  = position;
+  line->end    = position;
+  line->width  = 0;
+  line->rows   = 0;
+  line->closed = false;
+
+  return line;
+}
+
+static void _cwc_drop(cnc_wrap_cache *cwc, size_t count)
+{
+  // lines evicted from the buffer (_cb_scroll) leave from the front
+  memmove(cwc->lines, cwc->lines + count,
+          (cwc->size - count) * sizeof(*cwc->lines));
+
+  cwc->size -= count;
+  cwc->base += count;
+
+  if (cwc->reflow < cwc->base)
+  {
+    cwc->reflow = cwc->base;
+  }
+}
+
+static bool _cwc_row(cnc_buffer *cb, const cwc_line *line, size_t width,
+                     size_t *position, cwc_row *row)
+{
+  /*
+   * the row of at most width columns starting at *position, without
+   * breaking words: a row ends at its last whitespace when it has one, and
+   * the whitespace following a wrap is skipped.
+   * *position moves to the start of the next row. returns false for the
+   * last row of the line, empty for an empty line.
+   */
+
+  size_t current    = *position;
+  size_t row_width  = 0;
+  size_t last_space = *position;
+
+  row->start = *position;
+
+  while (current < line->end)
+  {
+    cnc_term_token *token = &cb->data[current - cb->dropped];
+    size_t          token_width = ctt_resolve_width(token);
+
+    if (row_width + token_width > width && current > row->start)
+    {
+      row->end = current;
+
+      if (last_space > row->start)
+      {
+        row->end = last_space;
+        current  = last_space + 1;
+
+        while (current < line->end &&
+               ctt_is_whitespace(cb->data[current - cb->dropped]))
+        {
+          current++;
+        }
+      }
+
+      *position = current;
+
+      return true;
+    }
+
+    if (ctt_is_whitespace(*token))
+    {
+      last_space = current;
+    }
+
+    row_width += token_width;
+    current++;
+  }
+
+  row->end  = line->end;
+  *position = line->end;
+
+  return false;
+}
+
+static size_t _cwc_wrap_line(cnc_buffer *cb, const cwc_line *line,
+                             size_t width, size_t first_row, cwc_row *rows,
+                             size_t max_rows)
+{
+  // rows [first_row, first_row + max_rows) are stored in rows.
+  // returns the number of rows of the line.
+  size_t  count    = 0;
+  size_t  position = line->start;
+  bool    more     = true;
+  cwc_row row;
+
+  while (more)
+  {
+    more = _cwc_row(cb, line, width, &position, &row);
+
+    if (count >= first_row && count - first_row < max_rows)
+    {
+      rows[count - first_row] = row;
+    }
+
+    count++;
+  }
+
+  return count;
+}
+
+// main functions
+void cwc_clear(cnc_wrap_cache *cwc)
+{
+  if (cwc == NULL)
+  {
+    return;
+  }
+
+  // line numbers keep growing: anchors on old lines clamp to the new ones
+  cwc->base += cwc->size;
+  cwc->size   = 0;
+  cwc->end    = 0;
+  cwc->reflow = cwc->base;
+}
+
+void cwc_destroy(cnc_wrap_cache *cwc)
+{
+  if (cwc == NULL)
+  {
+    return;
+  }
+
+  cal_free(cwc->allocator, cwc->lines);
+
+  cwc->lines    = NULL;
+  cwc->size     = 0;
+  cwc->capacity = 0;
+}
+
+size_t cwc_find_line(const cnc_wrap_cache *cwc, size_t position)
+{
+  // number of the last line starting at or before position
+  size_t lo = 0;
+  size_t hi = cwc->size;
+
+  while (lo + 1 < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+
+    if (cwc->lines[mid].start <= position)
+    {
+      lo = mid;
+    }
+
+    else
+    {
+      hi = mid;
+    }
+  }
+
+  return cwc->base + lo;
+}
+
+size_t cwc_find_row(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t line,
+                    size_t position)
+{
+  if (cwc == NULL || cb == NULL || line < cwc->base ||
+      line >= cwc->base + cwc->size)
+  {
+    return 0;
+  }
+
+  // row of line holding position, wrapped once from the start of the line
+  // and no further. past the end of the line: the last row
+  cwc_line *cl      = &cwc->lines[line - cwc->base];
+  size_t    current = cl->start;
+  size_t    count   = 0;
+  cwc_row   row;
+
+  while (_cwc_row(cb, cl, cwc->width, &current, &row) &&
+         position >= row.end)
+  {
+    count++;
+  }
+
+  cwc->wrapped += count + 1;
+
+  return count;
+}
+
+bool cwc_init(cnc_wrap_cache *cwc, const cnc_allocator *allocator)
+{
+  if (cwc == NULL)
+  {
+    return false;
+  }
+
+  cwc->allocator = allocator;
+  cwc->lines     = NULL;
+  cwc->size      = 0;
+  cwc->capacity  = 0;
+  cwc->base      = 0;
+  cwc->end       = 0;
+  cwc->version   = 0;
+  cwc->width     = 0;
+  cwc->reflow    = 0;
+  cwc->wrapped   = 0;
+
+  return true;
+}
+
+size_t cwc_line_rows(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t line)
+{
+  if (cwc == NULL || cb == NULL || line < cwc->base ||
+      line >= cwc->base + cwc->size)
+  {
+    return 0;
+  }
+
+  cwc_line *cl = &cwc->lines[line - cwc->base];
+
+  // rows are only counted again when the width changed
+  if (cl->width != cwc->width || cl->rows == 0)
+  {
+    cl->rows  = _cwc_wrap_line(cb, cl, cwc->width, 0, NULL, 0);
+    cl->width = cwc->width;
+
+    cwc->wrapped += cl->rows;
+  }
+
+  return cl->rows;
+}
+
+void cwc_move(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t *line, size_t *row,
+              ptrdiff_t delta)
+{
+  if (cwc == NULL || cb == NULL || line == NULL || row == NULL ||
+      cwc->size == 0)
+  {
+    return;
+  }
+
+  // walks delta rows from (line, row), stopping at the first and last rows
+  size_t last = cwc->base + cwc->size - 1;
+
+  while (delta > 0)
+  {
+    size_t rows = cwc_line_rows(cwc, cb, *line);
+
+    if (*row + delta < rows)
+    {
+      *row += delta;
+      break;
+    }
+
+    if (*line >= last)
+    {
+      *row = rows - 1;
+      break;
+    }
+
+    delta -= rows - *row;
+    (*line)++;
+    *row = 0;
+  }
+
+  while (delta < 0)
+  {
+    if (*row >= (size_t)-delta)
+    {
+      *row -= (size_t)-delta;
+      break;
+    }
+
+    if (*line <= cwc->base)
+    {
+      *row = 0;
+      break;
+    }
+
+    delta += *row + 1;
+    (*line)--;
+    *row = cwc_line_rows(cwc, cb, *line) - 1;
+  }
+}
+
+void cwc_reflow(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t budget)
+{
+  if (cwc == NULL || cb == NULL)
+  {
+    return;
+  }
+
+  // background pass: visit at most budget lines per call
+  for (size_t i = 0; i < budget && cwc->reflow < cwc->base + cwc->size; i++)
+  {
+    cwc_line_rows(cwc, cb, cwc->reflow++);
+  }
+}
+
+void cwc_set_width(cnc_wrap_cache *cwc, size_t width)
+{
+  if (cwc == NULL || cwc->width == width)
+  {
+    return;
+  }
+
+  // lines keep their old rows until they are reflowed
+  cwc->width  = width;
+  cwc->reflow = cwc->base;
+}
+
+void cwc_sync(cnc_wrap_cache *cwc, cnc_buffer *cb)
+{
+  if (cwc == NULL || cb == NULL || cb->data == NULL)
+  {
+    return;
+  }
+
+  size_t base = cb->dropped;
+  size_t end  = cb->dropped + cb->size;
+
+  // tokens already scanned were changed or removed: start over
+  if (cwc->version != cb->version || end < cwc->end)
+  {
+    cwc_clear(cwc);
+    cwc->version = cb->version;
+  }
+
+  // evicted lines leave, a partially evicted one starts at the new base
+  size_t evicted = 0;
+
+  while (evicted < cwc->size && cwc->lines[evicted].closed &&
+         cwc->lines[evicted].end < base)
+  {
+    evicted++;
+  }
+
+  if (evicted > 0)
+  {
+    _cwc_drop(cwc, evicted);
+  }
+
+  if (cwc->size > 0 && cwc->lines[0].start < base)
+  {
+    cwc->lines[0].start = base;
+    cwc->lines[0].width = 0;
+
+    if (cwc->lines[0].end < base)
+    {
+      cwc->lines[0].end = base;
+    }
+  }
+
+  if (cwc->end < base)
+  {
+    cwc->end = base;
+  }
+
+  // scan the appended tokens, the last line stays open until its C_ENT
+  size_t    first = cwc->size;
+  cwc_line *line  = NULL;
+
+  if (cwc->size > 0 && cwc->lines[cwc->size - 1].closed == false)
+  {
+    line  = &cwc->lines[cwc->size - 1];
+    first = cwc->size - 1;
+  }
+
+  for (size_t position = cwc->end; position < end; position++)
+  {
+    if (line == NULL)
+    {
+      line = _cwc_add(cwc, position);
+
+      if (line == NULL)
+      {
+        // out of memory: retry on the next sync
+        end = position;
+        break;
+      }
+    }
+
+    if (cb->data[position - base].token.value == C_ENT)
+    {
+      line->closed = true;
+      line         = NULL;
+
+      continue;
+    }
+
+    line->end = position + 1;
+  }
+
+  cwc->end = end;
+
+  // appended lines are wrapped right away, their text is new anyway
+  if (cwc->width > 0)
+  {
+    if (cwc->size > 0 && cwc->lines[0].width == 0)
+    {
+      cwc_line_rows(cwc, cb, cwc->base);
+    }
+
+    for (size_t i = first; i < cwc->size; i++)
+    {
+      cwc->lines[i].width = 0;
+      cwc_line_rows(cwc, cb, cwc->base + i);
+    }
+  }
+}
+
+void cwc_trim(cnc_wrap_cache *cwc)
+{
+  if (cwc == NULL || cwc->capacity <= CWC_LINES_INIT_CAP ||
+      cwc->size * 2 > cwc->capacity)
+  {
+    return;
+  }
+
+  // the lines table is halved until it is at least half full
+  size_t new_capacity = cwc->capacity;
+
+  while (new_capacity > CWC_LINES_INIT_CAP && cwc->size * 2 <= new_capacity)
+  {
+    new_capacity /= 2;
+  }
+
+  cwc_line *new_lines = cal_realloc(cwc->allocator, cwc->lines,
+                                    new_capacity * sizeof(*new_lines));
+
+  if (new_lines != NULL)
+  {
+    cwc->lines    = new_lines;
+    cwc->capacity = new_capacity;
+  }
+}
+
+void cwc_usage(const cnc_wrap_cache *cwc, cal_usage *usage)
+{
+  if (cwc == NULL || usage == NULL)
+  {
+    return;
+  }
+
+  usage->used += cwc->size * sizeof(*cwc->lines);
+  usage->reserved += cwc->capacity * sizeof(*cwc->lines);
+}
+
+size_t cwc_wrap(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t line,
+                size_t first_row, cwc_row *rows, size_t max_rows)
+{
+  if (cwc == NULL || cb == NULL || rows == NULL || line < cwc->base ||
+      line >= cwc->base + cwc->size)
+  {
+    return 0;
+  }
+
+  cwc_line *cl    = &cwc->lines[line - cwc->base];
+  size_t    count = _cwc_wrap_line(cb, cl, cwc->width, first_row, rows,
+                                   max_rows);
+
+  cwc->wrapped += count;
+
+  if (cl->width != cwc->width)
+  {
+    cl->rows  = count;
+    cl->width = cwc->width;
+  }
+
+  if (count <= first_row)
+  {
+    return 0;
+  }
+
+  return count - first_row < max_rows ? count - first_row : max_rows;
+}
@@ -0,0 +1,71 @@
+#ifndef CNC_WRAP_CACHE_H
+#define CNC_WRAP_CACHE_H
+
+// using cwc as shorthand for cnc_wrap_cache
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cnc_buffer.h"
+
+// lines table initial capacity
+#define CWC_LINES_INIT_CAP 64
+
+typedef struct
+{
+  size_t start;  // absolute position of the first token
+  size_t end;    // absolute position past the last token, C_ENT excluded
+  size_t width;  // wrap width rows were counted at, 0 if never wrapped
+  size_t rows;   // number of rows at width
+  bool   closed; // the line ends with a C_ENT
+
+} cwc_line;
+
+typedef struct
+{
+  size_t start; // absolute position of the first token
+  size_t end;   // absolute position past the last token
+
+} cwc_row;
+
+typedef struct
+{
+  const cnc_allocator *allocator;
+
+  cwc_line *lines;
+  size_t    size;
+  size_t    capacity;
+
+  size_t base;    // absolute number of lines[0], lines evicted so far
+  size_t end;     // absolute buffer end scanned for lines
+  size_t version; // cnc_buffer version the lines were built from
+
+  size_t width;  // current wrap width
+  size_t reflow; // lines below this absolute number are wrapped at width
+
+  size_t wrapped; // rows produced by wrap passes so far (statistics)
+
+} cnc_wrap_cache;
+
+// main functions
+void   cwc_clear(cnc_wrap_cache *cwc);
+void   cwc_destroy(cnc_wrap_cache *cwc);
+size_t cwc_find_line(const cnc_wrap_cache *cwc, size_t position);
+size_t cwc_find_row(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t line,
+                    size_t position);
+bool   cwc_init(cnc_wrap_cache *cwc, const cnc_allocator *allocator);
+size_t cwc_line_rows(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t line);
+void   cwc_move(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t *line, size_t *row,
+                ptrdiff_t delta);
+void   cwc_reflow(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t budget);
+void   cwc_set_width(cnc_wrap_cache *cwc, size_t width);
+void   cwc_sync(cnc_wrap_cache *cwc, cnc_buffer *cb);
+void   cwc_trim(cnc_wrap_cache *cwc);
+void   cwc_usage(const cnc_wrap_cache *cwc, cal_usage *usage);
+size_t cwc_wrap(cnc_wrap_cache *cwc, cnc_buffer *cb, size_t line,
+                size_t first_row, cwc_row *rows, size_t max_rows);
+
+#endif
@@ -18,17 +18,18 @@ int main(void)
   // cnc_widget   *info    = sample.cw_info_bar;
   cnc_widget *prompt = sample.cw_prompt;
 
-  // set main display widget
+  // set main display widget, following the newest line
   term->main_display_widget = display;
+  display->follow           = true;
 
   cb_append_txt(&display->buffer, "\ntesting a new red line .. ");
 
-  // call CTT_PV(C_COL) -> next token sets color info
-  cb_push(&display->buffer, CTT_PV(C_COL));
-  cb_push(&display->buffer, CTT_PV(KS_WHI_BG));
-  cb_push(&display->buffer, CTT_PV(C_COL));
-  cb_push(&display->buffer, CTT_PV(KS_RED_FG));
+  // styles apply to the text appended after them
+  cb_set_style(&display->buffer, CS_STYLE(CS_RED, CS_WHITE, 0));
   cb_append_txt(&display->buffer, " .. testing a new red line ");
+  cb_set_style(&display->buffer, CS_STYLE(CS_RGB(255, 135, 0), 0, CS_ITALIC));
+  cb_append_txt(&display->buffer, " (truecolor)");
+  cb_set_style(&display->buffer, CS_DEFAULT);
 
   cb_append_txt(&display->buffer, "\n This would be a normal line...");
 
@@ -51,14 +52,12 @@ int main(void)
 
       if (cb_equal_c_str(&prompt->buffer, "exit"))
       {
-        title->bg = CTT_PV(KS_RED_BG);
-        title->fg = CTT_PV(KS_BLA_FG);
+        title->style = CS_STYLE(CS_BLACK, CS_RED, CS_BOLD);
       }
 
       else
       {
-        title->bg = CTT_PV(KS_NON___);
-        title->fg = CTT_PV(KS_NON___);
+        title->style = CS_DEFAULT;
       }
 
       if (first_run)
@@ -75,11 +74,6 @@ int main(void)
       cb_append_txt(&display->buffer, "--> ");
       cb_append_buf(&display->buffer, &prompt->buffer);
 
-      if (display->data_index >= display->frame.height)
-      {
-        display->index++;
-      }
-
       cw_reset(prompt);
     }
 